@@ -1,7 +1,7 @@
 /*
 DigitalTouch.h - Library for Capacitive touch sensor with LED using only one Pin
 
-Version 1.1.0 (21.01.2019)
+Version 1.2.0 (unreleased)
 
 This Code is adapted from the AnalogTouch library by NicoHood.
 https://github.com/NicoHood/AnalogTouch
@@ -120,6 +120,18 @@ in your application, you may not want that the sample-and-hold cap in the ADC mu
 charged to this signal level again and again. So it very much depends on your application
 which method is preferable.
 
+Both methods can be mixed in one program: define "sensorx_adc" with the ADC channel number for
+all sensors that shall use the QTouchADC method (pin must be an ADC pin, Rp not required). These
+sensors are read through digitalTouchRead() like all others, so the filters and the calibration
+in the main program are the same. See function digitalTouchReadADC().
+
+The input threshold of the digital method depends on the temperature and the supply voltage,
+which causes a drift of the baseline. Controllers with analog comparator and Timer1 input capture
+(e.g. ATmega328, ATmega2560) can use the comparator instead: define "sensorx_acomp" with the ADC
+channel number. The threshold is then the stable bandgap reference or a voltage at pin AIN0, and
+the charging time is captured by the timer with a resolution of one CPU cycle.
+See function digitalTouchReadComparator().
+
 If you want to make a touch sensor from a very big component like the housing of
 a device or a lamp, you must use a completely different approach. Here, it is better to
 rely on the static charge instead on the capacitance. Just amplify the signal with some
@@ -144,6 +156,16 @@ Rs = 1..22kOhm, with 22kOhm I got a good brightness with a blue LED for an indic
 
 Rp = 100k..10MOhm, with 1MOhm I got good results, higher Rp increases resolution and noise
 
+Rp can be omitted if the sensor is charged through the internal pull-up of the pin (define
+sensorx_pullup, see example). This saves one part per channel and the measurement is very fast,
+but the resolution drops a lot: the pull-up has only 20..50kOhm (and varies with the chip and
+temperature), a typical sensor is charged after 5..30 CPU cycles. The library measures this with an
+unrolled kernel in steps of 2 cycles and the touch delta is only 1..3 counts per sample. So use
+digitalTouchAverage with a high number of samples and a low threshold. The pull-up needs the
+hard-coded functions (sensorx_read, sensorx_input, sensorx_high), the generic digitalTouchRead()
+with pinMode() is too slow for it, this is checked when compiling. Counts above 16 (a sensor that
+is still LOW after the unrolled kernel) are about 2.5 times coarser, see digitalTouchUnrolled.
+
 LED forward voltage > input-pin HIGH-level
 Add an extra diode between LED and Vss if required. This diode can be shared for multiple
 channels.
@@ -162,6 +184,9 @@ It requires to add some #define statements for each used sensor in the main prog
 In addition, I extended the code in a way that avoids any port access through the Arduino
 core functions like digitalWrite and digitalRead. This is also optional. Avoiding these
 funtions removes a significant part of the Arduino core from the program memory.
+Use the macros digitalTouchSetBit/digitalTouchClearBit for these definitions. They compile
+to single sbi/cbi instructions wherever the port allows it, so other code (e.g. an interrupt
+routine driving a different pin on the same port) cannot be disturbed by the touch library.
 
 The structure I found allows to do this without a lot of overhead in the compiled code.
 It only appears what is really used. But the library looks complicated since the options
@@ -178,13 +203,124 @@ Have fun!
 #pragma once
 
 // Software version
-#define DIGITALTOUCH_VERSION 110
+#define DIGITALTOUCH_VERSION 120
+
+
+// Atomic single-bit port access for the sensorx_input/output/low/high definitions
+// A statement like "PORTB = PORTB & B11111110" is a read-modify-write sequence. If an interrupt
+// routine changes another bit of the same port in between, its change gets lost. For registers
+// in the lower I/O space (data address below 0x40, e.g. PORTA..PORTG on the Mega, all ports on
+// ATmega328 and ATTINY*) the compiler emits a single sbi/cbi instruction for the following macros,
+// which cannot be interrupted and is also the fastest possible access (2 cycles, 1 word).
+// For registers above this range (e.g. PORTH..PORTL on the Mega) no single-bit instruction exists,
+// so the read-modify-write is wrapped in a short critical section instead.
+// The decision is made by the compiler from constants, no code is generated for the other branch.
+// usage: #define sensor1_low digitalTouchClearBit(PORTB, 0)
+#define digitalTouchClearBit(reg, bit) \
+	do { \
+		if (_SFR_MEM_ADDR(reg) < 0x40) { (reg) &= (uint8_t)~_BV(bit); } \
+		else { uint8_t digitalTouchSREG = SREG; cli(); (reg) &= (uint8_t)~_BV(bit); SREG = digitalTouchSREG; } \
+	} while (0)
+#define digitalTouchSetBit(reg, bit) \
+	do { \
+		if (_SFR_MEM_ADDR(reg) < 0x40) { (reg) |= (uint8_t)_BV(bit); } \
+		else { uint8_t digitalTouchSREG = SREG; cli(); (reg) |= (uint8_t)_BV(bit); SREG = digitalTouchSREG; } \
+	} while (0)
+
+// Toggling an output (e.g. blinking the LED of a sensor) does not need a read-modify-write at all:
+// writing a 1 to the PINx register toggles the corresponding PORTx bit in one instruction.
+// This is supported by all current AVRs (not by some very old ones like ATmega8/16/32).
+// usage: digitalTouchToggleBit(PINB, 0);
+#define digitalTouchToggleBit(pinReg, bit) ((pinReg) = (uint8_t)_BV(bit))
+
+// Unrolled measuring kernel for sensors charged through the internal pull-up
+// The charging time with the internal pull-up is only a few CPU cycles, the while loop with
+// its counter (around 5 cycles per count) would not resolve it. Here the input is checked 16 times
+// in a row without any counting, the compiler generates a chain of skip/jump instructions
+// (2 cycles per check with hard-coded sensorx_read). The counter value is a constant at every
+// check. If the input is still LOW afterwards, the normal while loop continues counting from 17.
+// The scale is not linear: counts 1..16 are 2 cycles each, from 17 on every count is a loop
+// iteration of about 5 cycles. A bigger sensor still gives a valid result, but a count above 16
+// is about 2.5 times larger than below, so deltas and thresholds of such sensors do not compare.
+#define digitalTouchUnrolled(input, counter) \
+	do { \
+		if (input) break; \
+		if (input) { counter = 2; break; } \
+		if (input) { counter = 3; break; } \
+		if (input) { counter = 4; break; } \
+		if (input) { counter = 5; break; } \
+		if (input) { counter = 6; break; } \
+		if (input) { counter = 7; break; } \
+		if (input) { counter = 8; break; } \
+		if (input) { counter = 9; break; } \
+		if (input) { counter = 10; break; } \
+		if (input) { counter = 11; break; } \
+		if (input) { counter = 12; break; } \
+		if (input) { counter = 13; break; } \
+		if (input) { counter = 14; break; } \
+		if (input) { counter = 15; break; } \
+		if (input) { counter = 16; break; } \
+		counter = 17; \
+	} while (0)
+
+// The pull-up charges a sensor within 5..30 CPU cycles. pinMode() and digitalWrite() take longer
+// than that, so the pull-up only works with the hard-coded functions: the switch to input, the
+// pull-up and the unrolled kernel must be single instructions.
+#if defined sensor1_pullup && !(defined sensor1_read && defined sensor1_input && defined sensor1_high)
+	#error "sensor1_pullup needs the hard-coded functions sensor1_read, sensor1_input and sensor1_high"
+#endif
+#if defined sensor2_pullup && !(defined sensor2_read && defined sensor2_input && defined sensor2_high)
+	#error "sensor2_pullup needs the hard-coded functions sensor2_read, sensor2_input and sensor2_high"
+#endif
+#if defined sensor3_pullup && !(defined sensor3_read && defined sensor3_input && defined sensor3_high)
+	#error "sensor3_pullup needs the hard-coded functions sensor3_read, sensor3_input and sensor3_high"
+#endif
+#if defined sensor4_pullup && !(defined sensor4_read && defined sensor4_input && defined sensor4_high)
+	#error "sensor4_pullup needs the hard-coded functions sensor4_read, sensor4_input and sensor4_high"
+#endif
+#if defined sensor5_pullup && !(defined sensor5_read && defined sensor5_input && defined sensor5_high)
+	#error "sensor5_pullup needs the hard-coded functions sensor5_read, sensor5_input and sensor5_high"
+#endif
+#if defined sensor6_pullup && !(defined sensor6_read && defined sensor6_input && defined sensor6_high)
+	#error "sensor6_pullup needs the hard-coded functions sensor6_read, sensor6_input and sensor6_high"
+#endif
+#if defined sensor7_pullup && !(defined sensor7_read && defined sensor7_input && defined sensor7_high)
+	#error "sensor7_pullup needs the hard-coded functions sensor7_read, sensor7_input and sensor7_high"
+#endif
+#if defined sensor8_pullup && !(defined sensor8_read && defined sensor8_input && defined sensor8_high)
+	#error "sensor8_pullup needs the hard-coded functions sensor8_read, sensor8_input and sensor8_high"
+#endif
+#if defined sensor9_pullup && !(defined sensor9_read && defined sensor9_input && defined sensor9_high)
+	#error "sensor9_pullup needs the hard-coded functions sensor9_read, sensor9_input and sensor9_high"
+#endif
+#if defined sensor10_pullup && !(defined sensor10_read && defined sensor10_input && defined sensor10_high)
+	#error "sensor10_pullup needs the hard-coded functions sensor10_read, sensor10_input and sensor10_high"
+#endif
+#if defined sensor11_pullup && !(defined sensor11_read && defined sensor11_input && defined sensor11_high)
+	#error "sensor11_pullup needs the hard-coded functions sensor11_read, sensor11_input and sensor11_high"
+#endif
+#if defined sensor12_pullup && !(defined sensor12_read && defined sensor12_input && defined sensor12_high)
+	#error "sensor12_pullup needs the hard-coded functions sensor12_read, sensor12_input and sensor12_high"
+#endif
+#if defined sensor13_pullup && !(defined sensor13_read && defined sensor13_input && defined sensor13_high)
+	#error "sensor13_pullup needs the hard-coded functions sensor13_read, sensor13_input and sensor13_high"
+#endif
+#if defined sensor14_pullup && !(defined sensor14_read && defined sensor14_input && defined sensor14_high)
+	#error "sensor14_pullup needs the hard-coded functions sensor14_read, sensor14_input and sensor14_high"
+#endif
+#if defined sensor15_pullup && !(defined sensor15_read && defined sensor15_input && defined sensor15_high)
+	#error "sensor15_pullup needs the hard-coded functions sensor15_read, sensor15_input and sensor15_high"
+#endif
+#if defined sensor16_pullup && !(defined sensor16_read && defined sensor16_input && defined sensor16_high)
+	#error "sensor16_pullup needs the hard-coded functions sensor16_read, sensor16_input and sensor16_high"
+#endif
 
 
 #ifdef sensor1_read
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor1)
 	// define "sensor1_read" in main program to enable this function, see example
 	// define also "sensor1_read/input/output/low/high" for ALL sensors in order to avoid Arduino IO functions
+	// define also "sensor1_pullup" to charge the sensor through the internal pull-up (needs sensor1_input and sensor1_high)
 	uint8_t digitalTouchRead_1() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor1_low
@@ -199,9 +335,22 @@ Have fun!
 		#else
 			pinMode(sensor1, INPUT);
 		#endif
+		#ifdef sensor1_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor1_high;
+			digitalTouchUnrolled(sensor1_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor1_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor1_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor1_low
+				sensor1_low;
+			#else
+				digitalWrite(sensor1, LOW);
+			#endif
+		#endif
 		#ifdef sensor1_output
 			sensor1_output;
 		#else
@@ -215,6 +364,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor2)
 	// define "sensor2_read" in main program to enable this function, see example
 	// define also "sensor2_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor2_pullup" to charge the sensor through the internal pull-up (needs sensor2_input and sensor2_high)
 	uint8_t digitalTouchRead_2() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor2_low
@@ -229,9 +379,22 @@ Have fun!
 		#else
 			pinMode(sensor2, INPUT);
 		#endif
+		#ifdef sensor2_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor2_high;
+			digitalTouchUnrolled(sensor2_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor2_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor2_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor2_low
+				sensor2_low;
+			#else
+				digitalWrite(sensor2, LOW);
+			#endif
+		#endif
 		#ifdef sensor2_output
 			sensor2_output;
 		#else
@@ -245,6 +408,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor3)
 	// define "sensor3_read" in main program to enable this function, see example
 	// define also "sensor3_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor3_pullup" to charge the sensor through the internal pull-up (needs sensor3_input and sensor3_high)
 	uint8_t digitalTouchRead_3() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor3_low
@@ -259,9 +423,22 @@ Have fun!
 		#else
 			pinMode(sensor3, INPUT);
 		#endif
+		#ifdef sensor3_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor3_high;
+			digitalTouchUnrolled(sensor3_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor3_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor3_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor3_low
+				sensor3_low;
+			#else
+				digitalWrite(sensor3, LOW);
+			#endif
+		#endif
 		#ifdef sensor3_output
 			sensor3_output;
 		#else
@@ -275,6 +452,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor4)
 	// define "sensor4_read" in main program to enable this function, see example
 	// define also "sensor4_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor4_pullup" to charge the sensor through the internal pull-up (needs sensor4_input and sensor4_high)
 	uint8_t digitalTouchRead_4() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor4_low
@@ -289,9 +467,22 @@ Have fun!
 		#else
 			pinMode(sensor4, INPUT);
 		#endif
+		#ifdef sensor4_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor4_high;
+			digitalTouchUnrolled(sensor4_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor4_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor4_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor4_low
+				sensor4_low;
+			#else
+				digitalWrite(sensor4, LOW);
+			#endif
+		#endif
 		#ifdef sensor4_output
 			sensor4_output;
 		#else
@@ -305,6 +496,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor5)
 	// define "sensor5_read" in main program to enable this function, see example
 	// define also "sensor5_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor5_pullup" to charge the sensor through the internal pull-up (needs sensor5_input and sensor5_high)
 	uint8_t digitalTouchRead_5() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor5_low
@@ -319,9 +511,22 @@ Have fun!
 		#else
 			pinMode(sensor5, INPUT);
 		#endif
+		#ifdef sensor5_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor5_high;
+			digitalTouchUnrolled(sensor5_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor5_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor5_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor5_low
+				sensor5_low;
+			#else
+				digitalWrite(sensor5, LOW);
+			#endif
+		#endif
 		#ifdef sensor5_output
 			sensor5_output;
 		#else
@@ -335,6 +540,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor6)
 	// define "sensor6_read" in main program to enable this function, see example
 	// define also "sensor6_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor6_pullup" to charge the sensor through the internal pull-up (needs sensor6_input and sensor6_high)
 	uint8_t digitalTouchRead_6() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor6_low
@@ -349,9 +555,22 @@ Have fun!
 		#else
 			pinMode(sensor6, INPUT);
 		#endif
+		#ifdef sensor6_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor6_high;
+			digitalTouchUnrolled(sensor6_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor6_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor6_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor6_low
+				sensor6_low;
+			#else
+				digitalWrite(sensor6, LOW);
+			#endif
+		#endif
 		#ifdef sensor6_output
 			sensor6_output;
 		#else
@@ -365,6 +584,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor7)
 	// define "sensor7_read" in main program to enable this function, see example
 	// define also "sensor7_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor7_pullup" to charge the sensor through the internal pull-up (needs sensor7_input and sensor7_high)
 	uint8_t digitalTouchRead_7() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor7_low
@@ -379,9 +599,22 @@ Have fun!
 		#else
 			pinMode(sensor7, INPUT);
 		#endif
+		#ifdef sensor7_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor7_high;
+			digitalTouchUnrolled(sensor7_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor7_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor7_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor7_low
+				sensor7_low;
+			#else
+				digitalWrite(sensor7, LOW);
+			#endif
+		#endif
 		#ifdef sensor7_output
 			sensor7_output;
 		#else
@@ -395,6 +628,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor8)
 	// define "sensor8_read" in main program to enable this function, see example
 	// define also "sensor8_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor8_pullup" to charge the sensor through the internal pull-up (needs sensor8_input and sensor8_high)
 	uint8_t digitalTouchRead_8() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor8_low
@@ -409,9 +643,22 @@ Have fun!
 		#else
 			pinMode(sensor8, INPUT);
 		#endif
+		#ifdef sensor8_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor8_high;
+			digitalTouchUnrolled(sensor8_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor8_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor8_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor8_low
+				sensor8_low;
+			#else
+				digitalWrite(sensor8, LOW);
+			#endif
+		#endif
 		#ifdef sensor8_output
 			sensor8_output;
 		#else
@@ -425,6 +672,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor9)
 	// define "sensor9_read" in main program to enable this function, see example
 	// define also "sensor9_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor9_pullup" to charge the sensor through the internal pull-up (needs sensor9_input and sensor9_high)
 	uint8_t digitalTouchRead_9() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor9_low
@@ -439,9 +687,22 @@ Have fun!
 		#else
 			pinMode(sensor9, INPUT);
 		#endif
+		#ifdef sensor9_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor9_high;
+			digitalTouchUnrolled(sensor9_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor9_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor9_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor9_low
+				sensor9_low;
+			#else
+				digitalWrite(sensor9, LOW);
+			#endif
+		#endif
 		#ifdef sensor9_output
 			sensor9_output;
 		#else
@@ -455,6 +716,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor10)
 	// define "sensor10_read" in main program to enable this function, see example
 	// define also "sensor10_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor10_pullup" to charge the sensor through the internal pull-up (needs sensor10_input and sensor10_high)
 	uint8_t digitalTouchRead_10() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor10_low
@@ -469,9 +731,22 @@ Have fun!
 		#else
 			pinMode(sensor10, INPUT);
 		#endif
+		#ifdef sensor10_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor10_high;
+			digitalTouchUnrolled(sensor10_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor10_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor10_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor10_low
+				sensor10_low;
+			#else
+				digitalWrite(sensor10, LOW);
+			#endif
+		#endif
 		#ifdef sensor10_output
 			sensor10_output;
 		#else
@@ -485,6 +760,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor11)
 	// define "sensor11_read" in main program to enable this function, see example
 	// define also "sensor11_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor11_pullup" to charge the sensor through the internal pull-up (needs sensor11_input and sensor11_high)
 	uint8_t digitalTouchRead_11() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor11_low
@@ -499,9 +775,22 @@ Have fun!
 		#else
 			pinMode(sensor11, INPUT);
 		#endif
+		#ifdef sensor11_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor11_high;
+			digitalTouchUnrolled(sensor11_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor11_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor11_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor11_low
+				sensor11_low;
+			#else
+				digitalWrite(sensor11, LOW);
+			#endif
+		#endif
 		#ifdef sensor11_output
 			sensor11_output;
 		#else
@@ -515,6 +804,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor12)
 	// define "sensor12_read" in main program to enable this function, see example
 	// define also "sensor12_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor12_pullup" to charge the sensor through the internal pull-up (needs sensor12_input and sensor12_high)
 	uint8_t digitalTouchRead_12() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor12_low
@@ -529,9 +819,22 @@ Have fun!
 		#else
 			pinMode(sensor12, INPUT);
 		#endif
+		#ifdef sensor12_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor12_high;
+			digitalTouchUnrolled(sensor12_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor12_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor12_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor12_low
+				sensor12_low;
+			#else
+				digitalWrite(sensor12, LOW);
+			#endif
+		#endif
 		#ifdef sensor12_output
 			sensor12_output;
 		#else
@@ -545,6 +848,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor13)
 	// define "sensor13_read" in main program to enable this function, see example
 	// define also "sensor13_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor13_pullup" to charge the sensor through the internal pull-up (needs sensor13_input and sensor13_high)
 	uint8_t digitalTouchRead_13() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor13_low
@@ -559,9 +863,22 @@ Have fun!
 		#else
 			pinMode(sensor13, INPUT);
 		#endif
+		#ifdef sensor13_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor13_high;
+			digitalTouchUnrolled(sensor13_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor13_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor13_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor13_low
+				sensor13_low;
+			#else
+				digitalWrite(sensor13, LOW);
+			#endif
+		#endif
 		#ifdef sensor13_output
 			sensor13_output;
 		#else
@@ -575,6 +892,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor14)
 	// define "sensor14_read" in main program to enable this function, see example
 	// define also "sensor14_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor14_pullup" to charge the sensor through the internal pull-up (needs sensor14_input and sensor14_high)
 	uint8_t digitalTouchRead_14() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor14_low
@@ -589,9 +907,22 @@ Have fun!
 		#else
 			pinMode(sensor14, INPUT);
 		#endif
+		#ifdef sensor14_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor14_high;
+			digitalTouchUnrolled(sensor14_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor14_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor14_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor14_low
+				sensor14_low;
+			#else
+				digitalWrite(sensor14, LOW);
+			#endif
+		#endif
 		#ifdef sensor14_output
 			sensor14_output;
 		#else
@@ -605,6 +936,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor15)
 	// define "sensor15_read" in main program to enable this function, see example
 	// define also "sensor15_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor15_pullup" to charge the sensor through the internal pull-up (needs sensor15_input and sensor15_high)
 	uint8_t digitalTouchRead_15() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor15_low
@@ -619,9 +951,22 @@ Have fun!
 		#else
 			pinMode(sensor15, INPUT);
 		#endif
+		#ifdef sensor15_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor15_high;
+			digitalTouchUnrolled(sensor15_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor15_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor15_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor15_low
+				sensor15_low;
+			#else
+				digitalWrite(sensor15, LOW);
+			#endif
+		#endif
 		#ifdef sensor15_output
 			sensor15_output;
 		#else
@@ -635,6 +980,7 @@ Have fun!
 	// this is the hard-coded (faster) version replacing digitalTouchRead(sensor16)
 	// define "sensor16_read" in main program to enable this function, see example
 	// define also "sensor16_input/output/low/high" in order to avoid Arduino IO functions
+	// define also "sensor16_pullup" to charge the sensor through the internal pull-up (needs sensor16_input and sensor16_high)
 	uint8_t digitalTouchRead_16() // for detailed comments see function digitalTouchRead()
 	{
 		#ifdef sensor16_low
@@ -649,9 +995,22 @@ Have fun!
 		#else
 			pinMode(sensor16, INPUT);
 		#endif
+		#ifdef sensor16_pullup
+			// charge through the internal pull-up, the first counts are measured by the unrolled kernel
+			sensor16_high;
+			digitalTouchUnrolled(sensor16_read, cycleCounter);
+		#endif
 		// here the hard-coded direct port reading appears
 		while (!sensor16_read && cycleCounter) cycleCounter++;
 		interrupts();
+		#ifdef sensor16_pullup
+			// pull-up off, otherwise the output would be driven HIGH
+			#ifdef sensor16_low
+				sensor16_low;
+			#else
+				digitalWrite(sensor16, LOW);
+			#endif
+		#endif
 		#ifdef sensor16_output
 			sensor16_output;
 		#else
@@ -661,12 +1020,271 @@ Have fun!
 	}
 #endif
 
+// Settings for the QTouchADC method (sensors with "sensorx_adc" defined)
+// ADMUX value that connects the ADC to ground (0V) and the reference selection (Vcc)
+// this differs between the controllers, define both in the main program for other chips
+#ifndef DIGITALTOUCH_ADC_GND
+	#if defined(__AVR_ATtiny25__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
+		#define DIGITALTOUCH_ADC_GND B00001101
+		#define DIGITALTOUCH_ADC_REF 0
+	#elif defined(__AVR_ATtiny24__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
+		#define DIGITALTOUCH_ADC_GND B00100000
+		#define DIGITALTOUCH_ADC_REF 0
+	#elif defined(MUX5)
+		// ATmega2560, ATmega32U4 and others with 6 mux bits (MUX5 in ADCSRB)
+		#define DIGITALTOUCH_ADC_GND B00011111
+		#define DIGITALTOUCH_ADC_REF _BV(REFS0)
+		#define DIGITALTOUCH_ADC_MUX5
+	#else
+		// ATmega328 and others with 4 mux bits
+		#define DIGITALTOUCH_ADC_GND B00001111
+		#define DIGITALTOUCH_ADC_REF _BV(REFS0)
+	#endif
+#endif
+
+// the 10 bit ADC result is shifted right by this number of bits to fit into the 8 bit result
+// of the library, use 1 or 0 for a higher resolution if the values are small enough (saturated at 255)
+#ifndef DIGITALTOUCH_ADC_SHIFT
+	#define DIGITALTOUCH_ADC_SHIFT 2
+#endif
+
+// function digitalTouchReadADC
+// takes one sample with the QTouchADC method (same as the AnalogTouch library) instead of the timing loop
+// It is used by digitalTouchRead() for all sensors with "sensorx_adc" defined, so all filters
+// and the calibration in the main program stay the same. "channel" is the ADC channel of the pin.
+// The sensor is charged to Vdd by the pull-up while the sample-and-hold cap of the ADC is discharged
+// by a conversion of the ground channel. Then both caps are connected and the voltage is converted.
+// A bigger sensor capacitance (touch) results in a higher voltage, so the result behaves like the
+// charging time of the digital method. No resistor Rp is required, but the ADC must be enabled
+// (done by the Arduino core) and cannot be used for other signals at the same time.
+#ifdef ADCSRA
+uint8_t digitalTouchReadADC(uint8_t pin, uint8_t channel)
+{
+	// precharge sensor through the pull-up, this limits the current if a LED is connected
+	pinMode(pin, INPUT_PULLUP);
+
+	// discharge the sample-and-hold cap by converting the ground channel
+	#ifdef DIGITALTOUCH_ADC_MUX5
+		digitalTouchClearBit(ADCSRB, MUX5);
+	#endif
+	ADMUX = DIGITALTOUCH_ADC_REF | DIGITALTOUCH_ADC_GND;
+	digitalTouchSetBit(ADCSRA, ADSC);
+	while (ADCSRA & _BV(ADSC));
+
+	// switch sensor to tristate (pull-up off) and connect it to the discharged sample-and-hold cap
+	// the charge is shared at the beginning of the conversion
+	noInterrupts();
+	pinMode(pin, INPUT);
+	#ifdef DIGITALTOUCH_ADC_MUX5
+		if (channel & B00001000) digitalTouchSetBit(ADCSRB, MUX5);
+		ADMUX = DIGITALTOUCH_ADC_REF | (channel & B00000111);
+	#else
+		ADMUX = DIGITALTOUCH_ADC_REF | channel;
+	#endif
+	digitalTouchSetBit(ADCSRA, ADSC);
+	interrupts();
+	while (ADCSRA & _BV(ADSC));
+	uint16_t value = ADC >> DIGITALTOUCH_ADC_SHIFT;
+
+	// discharge sensor cap (or use pin for LED, see example sketch)
+	digitalWrite(pin, LOW);
+	pinMode(pin, OUTPUT);
+
+	return value > 255 ? 255 : (uint8_t)value;
+}
+#endif
+
+// Settings for the comparator method (sensors with "sensorx_acomp" defined)
+// the capture time in CPU cycles is shifted right by this number of bits (result saturated at 255)
+#ifndef DIGITALTOUCH_ACOMP_SHIFT
+	#define DIGITALTOUCH_ACOMP_SHIFT 0
+#endif
+
+#if defined(ACIC) && defined(ACME) && defined(ICF1)
+// function digitalTouchReadComparator
+// takes one sample with the analog comparator and the input capture of Timer1
+// It is used by digitalTouchRead() for all sensors with "sensorx_acomp" defined, "channel" is the
+// ADC channel of the pin. The sensor is connected to the negative comparator input through the
+// ADC multiplexer, the positive input is the internal bandgap reference (1.1V) or, if
+// DIGITALTOUCH_ACOMP_AIN0 is defined, the pin AIN0 (connect a voltage divider or a filtered PWM
+// as programmable threshold). In contrast to the schmitt-trigger of the digital input, this
+// threshold does not depend on the temperature and the supply voltage.
+// The comparator output triggers the input capture, so the charging time is latched by hardware
+// with a resolution of one CPU cycle. No counting loop is required, interrupts are only blocked
+// for the start of the measurement.
+// While used, the ADC is switched off and Timer1 runs in normal mode without prescaler. Both are
+// restored afterwards, but a PWM output of Timer1 (analogWrite on its pins) may show a glitch.
+// The comparator itself stays configured for this method (bandgap needs time to settle).
+uint8_t digitalTouchReadComparator(uint8_t pin, uint8_t channel)
+{
+	// longest time that fits into the result
+	const uint16_t timeout = (uint16_t)(256UL << DIGITALTOUCH_ACOMP_SHIFT) - 1;
+
+	// direct port access for the start of the measurement, the timing must be exact
+	volatile uint8_t *modeRegister = portModeRegister(digitalPinToPort(pin));
+	uint8_t modeMask = digitalPinToBitMask(pin);
+
+	// discharge sensor cap by driving a LOW signal
+	digitalWrite(pin, LOW);
+	pinMode(pin, OUTPUT);
+
+	// ADC off, the multiplexer connects the sensor to the negative comparator input
+	uint8_t adcControl = ADCSRA;
+	ADCSRA = adcControl & (uint8_t)~_BV(ADEN);
+	#ifdef DIGITALTOUCH_ADC_MUX5
+		if (channel & B00001000) digitalTouchSetBit(ADCSRB, MUX5);
+		else digitalTouchClearBit(ADCSRB, MUX5);
+		ADMUX = (ADMUX & B11100000) | (channel & B00000111);
+	#else
+		ADMUX = (ADMUX & B11110000) | channel;
+	#endif
+	digitalTouchSetBit(ADCSRB, ACME);
+
+	// comparator output to input capture, positive input from bandgap or AIN0
+	#ifdef DIGITALTOUCH_ACOMP_AIN0
+		ACSR = _BV(ACIC);
+	#else
+		ACSR = _BV(ACBG) | _BV(ACIC);
+	#endif
+
+	// Timer1 in normal mode with full CPU clock, capture on the falling edge of the comparator
+	// output (it falls when the sensor voltage rises above the threshold)
+	uint8_t timerControlA = TCCR1A;
+	uint8_t timerControlB = TCCR1B;
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);
+
+	// start charging, the start time is taken directly after switching off the driver
+	noInterrupts();
+	TIFR1 = _BV(ICF1);
+	*modeRegister &= (uint8_t)~modeMask;
+	uint16_t start = TCNT1;
+	interrupts();
+
+	// wait for the capture, interrupts do not influence the result anymore
+	while (!(TIFR1 & _BV(ICF1)) && (uint16_t)(TCNT1 - start) < timeout);
+	uint16_t time = (TIFR1 & _BV(ICF1)) ? (uint16_t)(ICR1 - start) : timeout;
+
+	// discharge sensor cap (or use pin for LED, see example sketch)
+	pinMode(pin, OUTPUT);
+
+	// restore Timer1 and ADC
+	TCCR1B = timerControlB;
+	TCCR1A = timerControlA;
+	digitalTouchClearBit(ADCSRB, ACME);
+	ADCSRA = adcControl;
+
+	time >>= DIGITALTOUCH_ACOMP_SHIFT;
+	return time > 255 ? 255 : (uint8_t)time;
+}
+#endif
+
 // function digitalTouchRead
 // takes one sample of measurement of the specified sensor
 // works in stabel and well earthed environments, otherwise please use filter methods
 // digitalTouchAverage or digitalTouchMedian for a more reliable result
 uint8_t digitalTouchRead(uint8_t pin)
 {
+	// sensors with "sensorx_adc" use the QTouchADC method
+	#ifdef sensor1_adc
+		if (pin == sensor1) return digitalTouchReadADC(sensor1, sensor1_adc);
+	#endif
+	#ifdef sensor2_adc
+		if (pin == sensor2) return digitalTouchReadADC(sensor2, sensor2_adc);
+	#endif
+	#ifdef sensor3_adc
+		if (pin == sensor3) return digitalTouchReadADC(sensor3, sensor3_adc);
+	#endif
+	#ifdef sensor4_adc
+		if (pin == sensor4) return digitalTouchReadADC(sensor4, sensor4_adc);
+	#endif
+	#ifdef sensor5_adc
+		if (pin == sensor5) return digitalTouchReadADC(sensor5, sensor5_adc);
+	#endif
+	#ifdef sensor6_adc
+		if (pin == sensor6) return digitalTouchReadADC(sensor6, sensor6_adc);
+	#endif
+	#ifdef sensor7_adc
+		if (pin == sensor7) return digitalTouchReadADC(sensor7, sensor7_adc);
+	#endif
+	#ifdef sensor8_adc
+		if (pin == sensor8) return digitalTouchReadADC(sensor8, sensor8_adc);
+	#endif
+	#ifdef sensor9_adc
+		if (pin == sensor9) return digitalTouchReadADC(sensor9, sensor9_adc);
+	#endif
+	#ifdef sensor10_adc
+		if (pin == sensor10) return digitalTouchReadADC(sensor10, sensor10_adc);
+	#endif
+	#ifdef sensor11_adc
+		if (pin == sensor11) return digitalTouchReadADC(sensor11, sensor11_adc);
+	#endif
+	#ifdef sensor12_adc
+		if (pin == sensor12) return digitalTouchReadADC(sensor12, sensor12_adc);
+	#endif
+	#ifdef sensor13_adc
+		if (pin == sensor13) return digitalTouchReadADC(sensor13, sensor13_adc);
+	#endif
+	#ifdef sensor14_adc
+		if (pin == sensor14) return digitalTouchReadADC(sensor14, sensor14_adc);
+	#endif
+	#ifdef sensor15_adc
+		if (pin == sensor15) return digitalTouchReadADC(sensor15, sensor15_adc);
+	#endif
+	#ifdef sensor16_adc
+		if (pin == sensor16) return digitalTouchReadADC(sensor16, sensor16_adc);
+	#endif
+
+	// sensors with "sensorx_acomp" use the analog comparator and the input capture
+	#ifdef sensor1_acomp
+		if (pin == sensor1) return digitalTouchReadComparator(sensor1, sensor1_acomp);
+	#endif
+	#ifdef sensor2_acomp
+		if (pin == sensor2) return digitalTouchReadComparator(sensor2, sensor2_acomp);
+	#endif
+	#ifdef sensor3_acomp
+		if (pin == sensor3) return digitalTouchReadComparator(sensor3, sensor3_acomp);
+	#endif
+	#ifdef sensor4_acomp
+		if (pin == sensor4) return digitalTouchReadComparator(sensor4, sensor4_acomp);
+	#endif
+	#ifdef sensor5_acomp
+		if (pin == sensor5) return digitalTouchReadComparator(sensor5, sensor5_acomp);
+	#endif
+	#ifdef sensor6_acomp
+		if (pin == sensor6) return digitalTouchReadComparator(sensor6, sensor6_acomp);
+	#endif
+	#ifdef sensor7_acomp
+		if (pin == sensor7) return digitalTouchReadComparator(sensor7, sensor7_acomp);
+	#endif
+	#ifdef sensor8_acomp
+		if (pin == sensor8) return digitalTouchReadComparator(sensor8, sensor8_acomp);
+	#endif
+	#ifdef sensor9_acomp
+		if (pin == sensor9) return digitalTouchReadComparator(sensor9, sensor9_acomp);
+	#endif
+	#ifdef sensor10_acomp
+		if (pin == sensor10) return digitalTouchReadComparator(sensor10, sensor10_acomp);
+	#endif
+	#ifdef sensor11_acomp
+		if (pin == sensor11) return digitalTouchReadComparator(sensor11, sensor11_acomp);
+	#endif
+	#ifdef sensor12_acomp
+		if (pin == sensor12) return digitalTouchReadComparator(sensor12, sensor12_acomp);
+	#endif
+	#ifdef sensor13_acomp
+		if (pin == sensor13) return digitalTouchReadComparator(sensor13, sensor13_acomp);
+	#endif
+	#ifdef sensor14_acomp
+		if (pin == sensor14) return digitalTouchReadComparator(sensor14, sensor14_acomp);
+	#endif
+	#ifdef sensor15_acomp
+		if (pin == sensor15) return digitalTouchReadComparator(sensor15, sensor15_acomp);
+	#endif
+	#ifdef sensor16_acomp
+		if (pin == sensor16) return digitalTouchReadComparator(sensor16, sensor16_acomp);
+	#endif
+
 	// if hard-coded funtions exist, use them!
 	#ifdef sensor1_read
 		if (pin == sensor1) return digitalTouchRead_1();
@@ -716,26 +1334,32 @@ uint8_t digitalTouchRead(uint8_t pin)
 	#ifdef sensor16_read
 		if (pin == sensor16) return digitalTouchRead_16();
 	#endif
+
+	// on Linux single-board computers the GPIO character device backend measures the time
+	// (include extras/linux/DigitalTouchGpio.h instead of this file, see there)
+	#ifdef DIGITALTOUCH_LINUX_GPIO
+		return digitalTouchReadGpio(pin);
+	#endif
 	
 	// the rest of the function is only used if there is a sensor left that is used but has no
-	// definition for sensorx_read
+	// definition for sensorx_read, sensorx_adc or sensorx_acomp
 	#if \
-	 (defined sensor1 & !defined sensor1_read) || \
-	 (defined sensor2 & !defined sensor2_read) || \
-	 (defined sensor3 & !defined sensor3_read) || \
-	 (defined sensor4 & !defined sensor4_read) || \
-	 (defined sensor5 & !defined sensor5_read) || \
-	 (defined sensor6 & !defined sensor6_read) || \
-	 (defined sensor7 & !defined sensor7_read) || \
-	 (defined sensor8 & !defined sensor8_read) || \
-	 (defined sensor9 & !defined sensor9_read) || \
-	 (defined sensor10 & !defined sensor10_read) || \
-	 (defined sensor11 & !defined sensor11_read) || \
-	 (defined sensor12 & !defined sensor12_read) || \
-	 (defined sensor13 & !defined sensor13_read) || \
-	 (defined sensor14 & !defined sensor14_read) || \
-	 (defined sensor15 & !defined sensor15_read) || \
-	 (defined sensor16 & !defined sensor16_read)
+	 (defined sensor1 & !defined sensor1_read & !defined sensor1_adc & !defined sensor1_acomp) || \
+	 (defined sensor2 & !defined sensor2_read & !defined sensor2_adc & !defined sensor2_acomp) || \
+	 (defined sensor3 & !defined sensor3_read & !defined sensor3_adc & !defined sensor3_acomp) || \
+	 (defined sensor4 & !defined sensor4_read & !defined sensor4_adc & !defined sensor4_acomp) || \
+	 (defined sensor5 & !defined sensor5_read & !defined sensor5_adc & !defined sensor5_acomp) || \
+	 (defined sensor6 & !defined sensor6_read & !defined sensor6_adc & !defined sensor6_acomp) || \
+	 (defined sensor7 & !defined sensor7_read & !defined sensor7_adc & !defined sensor7_acomp) || \
+	 (defined sensor8 & !defined sensor8_read & !defined sensor8_adc & !defined sensor8_acomp) || \
+	 (defined sensor9 & !defined sensor9_read & !defined sensor9_adc & !defined sensor9_acomp) || \
+	 (defined sensor10 & !defined sensor10_read & !defined sensor10_adc & !defined sensor10_acomp) || \
+	 (defined sensor11 & !defined sensor11_read & !defined sensor11_adc & !defined sensor11_acomp) || \
+	 (defined sensor12 & !defined sensor12_read & !defined sensor12_adc & !defined sensor12_acomp) || \
+	 (defined sensor13 & !defined sensor13_read & !defined sensor13_adc & !defined sensor13_acomp) || \
+	 (defined sensor14 & !defined sensor14_read & !defined sensor14_adc & !defined sensor14_acomp) || \
+	 (defined sensor15 & !defined sensor15_read & !defined sensor15_adc & !defined sensor15_acomp) || \
+	 (defined sensor16 & !defined sensor16_read & !defined sensor16_adc & !defined sensor16_acomp)
 		// discharge sensor cap by driving a LOW signal
 		digitalWrite(pin, LOW);
 
@@ -749,8 +1373,9 @@ uint8_t digitalTouchRead(uint8_t pin)
 
 		// with interrupts during the measurement we would miss a lot of counts
 		noInterrupts();
-		
+
 		// switch off driver, sensor cap starts to charge through external resistor
+		// (not through the internal pull-up, pinMode() takes longer than that charging time)
 		pinMode(pin, INPUT);
 		
 		// charge the sensor until signal is HIGH or counter is 0 (= overflow)
@@ -771,22 +1396,104 @@ uint8_t digitalTouchRead(uint8_t pin)
 }
 
 
+#ifdef __AVR__
+// function digitalTouchReadPort
+// takes one sample of up to 8 sensors on the same port at once (port-parallel measurement)
+// "mask" selects the sensors (bits of the port), "values" has 8 bytes, values[bit] is written for
+// every bit of the mask (255 = overflow), the sensors must have an external Rp
+// Example for PORTD: digitalTouchReadPort(&DDRD, &PORTD, &PIND, 0xFC, values);
+// When sensors get HIGH, the loop only stores their bits and the counter and the values are
+// written after the measurement, but this count still takes some cycles more than the others.
+// So the sensors of a port couple a little: if a touch delays one sensor past another one, the
+// extra cycles now come after the other sensor, and its count rises by the time of the store.
+// Keep the threshold above this or measure sensors with a similar baseline on one port.
+// It is much faster than 8 single measurements for the pads of a grid, see DigitalTouchPad.h.
+void digitalTouchReadPort(volatile uint8_t *ddr, volatile uint8_t *port, volatile uint8_t *pinReg, uint8_t mask, uint8_t *values)
+{
+	uint8_t pending = mask;
+	uint8_t cycleCounter = 0;
+
+	// sensors that got HIGH at the same count and this count, at most 8 changes
+	uint8_t changed[8];
+	uint8_t counts[8];
+	uint8_t changes = 0;
+
+	noInterrupts();
+
+	// switch all sensors to input at the same time, they are LOW (discharged) before
+	*port &= ~mask;
+	*ddr &= ~mask;
+
+	// count until all sensors are HIGH or overflow, a change is only stored (short and constant)
+	do {
+		uint8_t high = *pinReg & pending;
+		if (high) {
+			pending &= ~high;
+			changed[changes] = high;
+			counts[changes++] = cycleCounter;
+		}
+	} while (pending && ++cycleCounter != 255);
+
+	// discharge all sensors
+	*ddr |= mask;
+
+	interrupts();
+
+	// overflow for all sensors that did not get HIGH, the count of the change for all others
+	for (uint8_t bit = 0; bit < 8; bit++) {
+		if (mask & (1 << bit)) values[bit] = 255;
+	}
+	for (uint8_t change = 0; change < changes; change++) {
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			if (changed[change] & (1 << bit)) values[bit] = counts[change];
+		}
+	}
+}
+#endif
+
+
+// Histogram of the samples
+// For the diagnosis of a sensor the distribution of the single samples shows more than the average:
+// two peaks for noise from a switching power supply or leakage of a LED, a wide distribution
+// for a bad ground. digitalTouchAverage can count every sample in a histogram of 16 bins with 8 bit
+// counters (saturated at 255) in the main program. Bin 8 starts at the baseline, every bin is
+// 2^DIGITALTOUCH_HISTOGRAM_SHIFT counts wide, bins 0 and 15 also count all samples below and above.
+// Dump the bins e.g. with the telemetry (DigitalTouchTelemetry.h) and clear them for a new record.
+#ifndef DIGITALTOUCH_HISTOGRAM_SHIFT
+	#define DIGITALTOUCH_HISTOGRAM_SHIFT 0
+#endif
+
+// function digitalTouchHistogram
+// counts one sample in the 16 "bins" of a sensor, "baseline" is ref >> offset
+void digitalTouchHistogram(uint8_t *bins, uint8_t value, uint8_t baseline)
+{
+	int16_t bin = (((int16_t)value - baseline) >> DIGITALTOUCH_HISTOGRAM_SHIFT) + 8;
+	if (bin < 0) bin = 0;
+	if (bin > 15) bin = 15;
+	if (bins[bin] != 255) bins[bin]++;
+}
+
 // function digitalTouchAverage
 // take the average of a number of samples
 // This method is useful, if you want to have a high number of samples for best results.
 // It also can be used with samples = 1 (default), it will add one prior sample, which is
 // ignored for better stability after the pin has been used for a LED.
-uint8_t digitalTouchAverage(uint8_t pin, uint8_t samples = 1)
+// With "histogram" (16 bytes) every sample is counted there, see digitalTouchHistogram.
+uint8_t digitalTouchAverage(uint8_t pin, uint8_t samples = 1, uint8_t *histogram = 0, uint8_t baseline = 0)
 {
 	uint16_t value = 0;
 	
-	// ignore first sample
-	digitalTouchRead(pin);
+	// ignore first sample (not needed with separate baselines for the LED state, see digitalTouchDeltaLED)
+	#ifndef DIGITALTOUCH_NO_DISCARD
+		digitalTouchRead(pin);
+	#endif
 
 	// read specified number of samples and add result
 	for (uint8_t i = 0; i < samples; i++)
 	{
-		value += (uint16_t)digitalTouchRead(pin);
+		uint8_t sample = digitalTouchRead(pin);
+		value += (uint16_t)sample;
+		if (histogram) digitalTouchHistogram(histogram, sample, baseline);
 	}
 
 	// return average
@@ -794,23 +1501,35 @@ uint8_t digitalTouchAverage(uint8_t pin, uint8_t samples = 1)
 }
 
 
-// function digitalTouchMedian
-// take the median of three samples
-// The median is more useful for a small number of samples (3 in this case), because it ignores
-// single outliers completely while the average would be strongly affected.
-// It also adds one prior sample, which is ignored for better stability after the pin has been used
-// for a LED. 
-uint8_t digitalTouchMedian(uint8_t pin)
+// function digitalTouchSum
+// take the sum of a number of samples, saturated to 255
+// Unlike the average, the sum increases the delta of a touch with the number of samples, so a
+// small sensor gets more counts (resolution). Choose "samples" so that the baseline times samples
+// stays well below 255, see the automatic gain control in DigitalTouchGain.h.
+uint8_t digitalTouchSum(uint8_t pin, uint8_t samples)
 {
-	// first sample is ignored
-	digitalTouchRead(pin);
+	uint16_t value = 0;
+
+	// ignore first sample, same as digitalTouchAverage
+	#ifndef DIGITALTOUCH_NO_DISCARD
+		digitalTouchRead(pin);
+	#endif
+
+	// read specified number of samples and add result
+	for (uint8_t i = 0; i < samples; i++)
+	{
+		value += (uint16_t)digitalTouchRead(pin);
+		if (value >= 255) return 255;
+	}
+
+	return (uint8_t)value;
+}
 
-	// take three samples
-	uint8_t value0 = digitalTouchRead(pin);
-    uint8_t value1 = digitalTouchRead(pin);
-    uint8_t value2 = digitalTouchRead(pin);
 
-	// find the median, which is the middle value in a sorted list, no value is modified
+// function digitalTouchMedian3
+// median of three values, which is the middle value in a sorted list, no value is modified
+uint8_t digitalTouchMedian3(uint8_t value0, uint8_t value1, uint8_t value2)
+{
 	if (value0 < value1) {
 		if (value1 < value2) {
 			return value1;
@@ -831,6 +1550,28 @@ uint8_t digitalTouchMedian(uint8_t pin)
 	return value0;
 }
 
+
+// function digitalTouchMedian
+// take the median of three samples
+// The median is more useful for a small number of samples (3 in this case), because it ignores
+// single outliers completely while the average would be strongly affected.
+// It also adds one prior sample, which is ignored for better stability after the pin has been used
+// for a LED. 
+uint8_t digitalTouchMedian(uint8_t pin)
+{
+	// first sample is ignored (not needed with separate baselines for the LED state)
+	#ifndef DIGITALTOUCH_NO_DISCARD
+		digitalTouchRead(pin);
+	#endif
+
+	// take three samples
+	uint8_t value0 = digitalTouchRead(pin);
+    uint8_t value1 = digitalTouchRead(pin);
+    uint8_t value2 = digitalTouchRead(pin);
+
+	return digitalTouchMedian3(value0, value1, value2);
+}
+
 // function sensorLEDsOff
 // switches all sensor output ports to low
 // this must be done for all pins before the first sensor is sampled, so we need this extra function
@@ -918,3 +1659,69 @@ void sensorLEDsOff()
     digitalWrite(sensor16, LOW);
   #endif
 }
+
+// function digitalTouchDelta
+// returns the difference between a filtered value and the baseline "ref" of the sensor
+// "ref" is stored with "offset" additional bits for a finer calibration, see digitalTouchCalibrate()
+// a touched sensor has a positive delta above the threshold of the main program
+int16_t digitalTouchDelta(uint8_t value, uint16_t ref, uint8_t offset)
+{
+	return (int16_t)value - (int16_t)(uint8_t)(ref >> offset);
+}
+
+// function digitalTouchDeltas
+// calculates the delta of "count" sensors at once into a packed array with one byte per sensor
+// (saturated to -128..127), the format used by the event functions in DigitalTouchEvents.h
+void digitalTouchDeltas(int8_t *deltas, const uint8_t *values, const uint16_t *refs, uint8_t count, uint8_t offset)
+{
+	for (uint8_t i = 0; i < count; i++) {
+		int16_t delta = digitalTouchDelta(values[i], refs[i], offset);
+		deltas[i] = delta > 127 ? 127 : (delta < -128 ? -128 : (int8_t)delta);
+	}
+}
+
+// function digitalTouchCalibrate
+// self calibration of the baseline "ref", call it once per measurement and store the result
+// Start with ref = 0xFFFF, the baseline then takes the first value.
+// If the value is not above the baseline, the baseline follows immediately. Otherwise it cools down
+// by one step of 1/2^offset per call, so a short touch has no effect but a permanent change of the
+// environment is learned after some time. offset is 0..8, a higher offset means slower cool down.
+uint16_t digitalTouchCalibrate(uint16_t ref, uint8_t value, uint8_t offset)
+{
+	// self calibrate
+	if (value <= (uint8_t)(ref >> offset)) return ((uint16_t)value << offset);
+	// cool down
+	return ref + 1;
+}
+
+// Separate baselines for sensors with LED
+// If the LED at a sensor pin was on before the measurement, the residual charge and the leakage of
+// the LED shift the value a bit. This is why digitalTouchAverage and digitalTouchMedian ignore a
+// first sample. Instead of that, two baselines can be stored for such a sensor:
+// refs[0] for measurements after the LED was off, refs[1] after it was on (both start with 0xFFFF).
+// "led" is the state of the LED before the measurement (before sensorLEDsOff() was called).
+// The baseline then does not jump when the LED is switched, and the first sample can be saved
+// by defining DIGITALTOUCH_NO_DISCARD before including the library.
+
+// function digitalTouchDeltaLED
+// same as digitalTouchDelta, but with the baseline for the LED state
+// as long as no measurement with LED on was calibrated, the LED-off baseline is used
+int16_t digitalTouchDeltaLED(uint8_t value, const uint16_t *refs, bool led, uint8_t offset)
+{
+	uint16_t ref = (led && refs[1] != 0xFFFF) ? refs[1] : refs[0];
+	return digitalTouchDelta(value, ref, offset);
+}
+
+// function digitalTouchCalibrateLED
+// same as digitalTouchCalibrate, but only the baseline for the LED state is changed
+// the LED-on baseline starts from the LED-off baseline, it is normally switched on by a touch
+// and must not learn the touched value
+void digitalTouchCalibrateLED(uint16_t *refs, uint8_t value, bool led, uint8_t offset)
+{
+	if (!led) {
+		refs[0] = digitalTouchCalibrate(refs[0], value, offset);
+		return;
+	}
+	if (refs[1] == 0xFFFF) refs[1] = refs[0];
+	refs[1] = digitalTouchCalibrate(refs[1], value, offset);
+}
@@ -0,0 +1,245 @@
+/*
+DigitalTouchConsole.h - Tuning console over serial for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+With #define statements for the thresholds, the samples and the offset, every tuning step needs
+a new upload. With this console the parameters of every sensor are in a config table in RAM and
+can be read and changed over the serial monitor while the sensors are running. The scan reads
+the table like an array of constants (config[i].threshold), so it is as fast as the #define.
+When the values are found, write them back as #define statements or as initial table.
+The console is only compiled if this file is included (after DigitalTouch.h).
+
+Commands, one per line (sensor is 0..count-1 or * for all sensors):
+	?                      list the config of all sensors
+	t <sensor> <value>     threshold
+	s <sensor> <value>     samples (1..255)
+	f <sensor> <value>     filter: 0 average, 1 median (of 3), 2 sum
+	o <sensor> <value>     offset = baseline rate of digitalTouchCalibrate() (0..8)
+	r [scans]              stream sensor, value, baseline, delta for a number of scans
+	                       (no number: until "r 0")
+Every command is answered with "ok" or "error", lines longer than DIGITALTOUCH_CONSOLE_LINE - 1
+characters are rejected with "error".
+The sum filter scales the values with the samples, so "s" (with the sum filter) and "f" scale the
+baseline to the new range, the same as "o" keeps the baseline with the new offset. Otherwise the
+next scans would report large deltas until the baseline has followed.
+
+Usage:
+
+	DigitalTouchConfig config[2] = { { 4, 5, DIGITALTOUCH_FILTER_AVERAGE, 4 }, { ... } };
+	uint16_t refs[2] = { 0xFFFF, 0xFFFF };
+	DigitalTouchConsole console = { config, refs, 2, &Serial };
+	...
+	digitalTouchConsolePoll(&console);
+	values[i] = digitalTouchFilter(pins[i], &config[i]);
+	deltas[i] = digitalTouchDelta(values[i], refs[i], config[i].offset);  (limited to int8_t)
+	refs[i] = digitalTouchCalibrate(refs[i], values[i], config[i].offset);
+	digitalTouchConsoleStats(&console, values, deltas);
+*/
+
+// Include guard
+#pragma once
+
+#include <Arduino.h>
+
+// filters of DigitalTouchConfig
+#define DIGITALTOUCH_FILTER_AVERAGE 0
+#define DIGITALTOUCH_FILTER_MEDIAN  1
+#define DIGITALTOUCH_FILTER_SUM     2
+
+// length of a command line
+#ifndef DIGITALTOUCH_CONSOLE_LINE
+	#define DIGITALTOUCH_CONSOLE_LINE 16
+#endif
+
+// parameters of one sensor
+struct DigitalTouchConfig {
+	uint8_t threshold; // threshold for the touch (digitalTouchEvent() or the main program)
+	uint8_t samples;   // number of samples
+	uint8_t filter;    // DIGITALTOUCH_FILTER_...
+	uint8_t offset;    // baseline rate, see digitalTouchCalibrate()
+};
+
+// state of the console in the main program, start with { config, refs, count, &Serial }
+struct DigitalTouchConsole {
+	DigitalTouchConfig *config;
+	uint16_t *refs;  // baselines, rescaled with offset, samples and filter (NULL: not rescaled)
+	uint8_t count;
+	Stream *serial;
+	uint16_t stream; // scans to stream, 0xFFFF = endless
+	uint8_t length;  // characters in the line, DIGITALTOUCH_CONSOLE_LINE: line too long
+	char line[DIGITALTOUCH_CONSOLE_LINE];
+};
+
+// function digitalTouchFilter
+// takes the filtered value of a sensor with the filter and the samples of its config
+uint8_t digitalTouchFilter(uint8_t pin, const DigitalTouchConfig *config)
+{
+	switch (config->filter) {
+		case DIGITALTOUCH_FILTER_MEDIAN:
+			return digitalTouchMedian(pin);
+		case DIGITALTOUCH_FILTER_SUM:
+			return digitalTouchSum(pin, config->samples);
+		default:
+			return digitalTouchAverage(pin, config->samples);
+	}
+}
+
+// function digitalTouchConsoleNumber
+// parses a decimal number at "*text" and moves the pointer behind it
+// returns -1 if there is no number
+int16_t digitalTouchConsoleNumber(const char **text)
+{
+	while (**text == ' ') (*text)++;
+	if (**text < '0' || **text > '9') return -1;
+	int16_t number = 0;
+	while (**text >= '0' && **text <= '9') {
+		number = number * 10 + (**text - '0');
+		if (number > 999) return -1;
+		(*text)++;
+	}
+	return number;
+}
+
+// function digitalTouchConsoleScale
+// factor of the values of a config compared with a single sample
+uint8_t digitalTouchConsoleScale(const DigitalTouchConfig *config)
+{
+	return config->filter == DIGITALTOUCH_FILTER_SUM ? config->samples : 1;
+}
+
+// function digitalTouchConsoleRescale
+// scales the baseline of a sensor from the values of config "before" to those of its config now
+void digitalTouchConsoleRescale(DigitalTouchConsole *console, uint8_t sensor, const DigitalTouchConfig *before)
+{
+	const DigitalTouchConfig *config = &console->config[sensor];
+	if (!console->refs || console->refs[sensor] == 0xFFFF) return;
+	uint32_t ref = (uint32_t)console->refs[sensor] * digitalTouchConsoleScale(config) / digitalTouchConsoleScale(before);
+	// the sum saturates at 255
+	uint32_t limit = (uint32_t)255 << config->offset;
+	console->refs[sensor] = (uint16_t)(ref > limit ? limit : ref);
+}
+
+// function digitalTouchConsoleSet
+// sets one parameter of one sensor
+bool digitalTouchConsoleSet(DigitalTouchConsole *console, uint8_t sensor, char parameter, uint8_t value)
+{
+	DigitalTouchConfig *config = &console->config[sensor];
+	DigitalTouchConfig before = *config;
+	switch (parameter) {
+		case 't':
+			config->threshold = value;
+			return true;
+		case 's':
+			if (value == 0) return false;
+			config->samples = value;
+			digitalTouchConsoleRescale(console, sensor, &before);
+			return true;
+		case 'f':
+			if (value > DIGITALTOUCH_FILTER_SUM) return false;
+			config->filter = value;
+			digitalTouchConsoleRescale(console, sensor, &before);
+			return true;
+		case 'o':
+			if (value > 8) return false;
+			// keep the baseline, only the number of additional bits changes
+			if (console->refs && console->refs[sensor] != 0xFFFF) {
+				uint16_t ref = console->refs[sensor];
+				console->refs[sensor] = value > config->offset ? ref << (value - config->offset) : ref >> (config->offset - value);
+			}
+			config->offset = value;
+			return true;
+	}
+	return false;
+}
+
+// function digitalTouchConsoleCommand
+// executes one command line
+bool digitalTouchConsoleCommand(DigitalTouchConsole *console, const char *text)
+{
+	char command = *text++;
+
+	if (command == '?') {
+		console->serial->println(F("sensor\tthreshold\tsamples\tfilter\toffset"));
+		for (uint8_t i = 0; i < console->count; i++) {
+			DigitalTouchConfig *config = &console->config[i];
+			console->serial->print(i);
+			console->serial->print('\t');
+			console->serial->print(config->threshold);
+			console->serial->print('\t');
+			console->serial->print(config->samples);
+			console->serial->print('\t');
+			console->serial->print(config->filter);
+			console->serial->print('\t');
+			console->serial->println(config->offset);
+		}
+		return true;
+	}
+
+	if (command == 'r') {
+		int16_t scans = digitalTouchConsoleNumber(&text);
+		console->stream = scans < 0 ? 0xFFFF : (uint16_t)scans;
+		return true;
+	}
+
+	// set a parameter of one or all sensors
+	while (*text == ' ') text++;
+	bool all = *text == '*';
+	int16_t sensor = 0;
+	if (all) text++;
+	else sensor = digitalTouchConsoleNumber(&text);
+	int16_t value = digitalTouchConsoleNumber(&text);
+	if (sensor < 0 || sensor >= console->count || value < 0 || value > 255) return false;
+
+	uint8_t first = all ? 0 : (uint8_t)sensor;
+	uint8_t last = all ? console->count : (uint8_t)sensor + 1;
+	for (uint8_t i = first; i < last; i++) {
+		if (!digitalTouchConsoleSet(console, i, command, (uint8_t)value)) return false;
+	}
+	return true;
+}
+
+// function digitalTouchConsolePoll
+// reads the available characters and executes a complete line, call it once per scan
+// returns true if a command was executed
+bool digitalTouchConsolePoll(DigitalTouchConsole *console)
+{
+	while (console->serial->available()) {
+		char c = (char)console->serial->read();
+		if (c != '\n' && c != '\r') {
+			if (console->length < DIGITALTOUCH_CONSOLE_LINE - 1) console->line[console->length++] = c;
+			else console->length = DIGITALTOUCH_CONSOLE_LINE;
+			continue;
+		}
+		if (console->length == 0) continue;
+
+		// a line that was too long is not executed
+		bool valid = console->length < DIGITALTOUCH_CONSOLE_LINE;
+		if (valid) console->line[console->length] = 0;
+		console->length = 0;
+		console->serial->println(valid && digitalTouchConsoleCommand(console, console->line) ? F("ok") : F("error"));
+		return true;
+	}
+	return false;
+}
+
+// function digitalTouchConsoleStats
+// streams sensor, value, baseline and delta of all sensors if requested with "r", call it once
+// per scan with the values and deltas of the scan
+void digitalTouchConsoleStats(DigitalTouchConsole *console, const uint8_t *values, const int8_t *deltas)
+{
+	if (console->stream == 0) return;
+	if (console->stream != 0xFFFF) console->stream--;
+
+	for (uint8_t i = 0; i < console->count; i++) {
+		console->serial->print(i);
+		console->serial->print('\t');
+		console->serial->print(values[i]);
+		console->serial->print('\t');
+		if (console->refs) console->serial->print(console->refs[i] >> console->config[i].offset);
+		console->serial->print('\t');
+		console->serial->print((int16_t)deltas[i]);
+		console->serial->print(i < console->count - 1 ? '\t' : '\n');
+	}
+}
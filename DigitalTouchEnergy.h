@@ -0,0 +1,115 @@
+/*
+DigitalTouchEnergy.h - Energy per scan for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+For a battery device the average current decides about the battery life. It depends on the
+configuration: the CPU is active while it counts the charging time (the busy loop of
+digitalTouchRead() for every sample), a sensor pin that is LOW between the measurements draws
+Vdd / Rp through its resistor (5uA with 5V and 1MOhm, the largest part in sleep), a LED draws its
+current while it is on, and the rest of the scan period the controller sleeps.
+
+DigitalTouchEnergy adds up the time of these parts, digitalTouchEnergyCharge() and
+digitalTouchEnergyCurrent() convert them with the constants of the board (DigitalTouchBoard)
+into the charge and the average current. On the controller digitalTouchEnergyMeasure() takes the
+active time of a scan with micros() (resolution 4us at 16MHz, so only the sum of many scans is
+meaningful), on Linux extras/linux/touchenergy calculates it from recorded values, so sample
+counts, scan periods and LED duty cycles can be compared before the hardware is built:
+
+	uint32_t start = micros();
+	// ... all measurements and the processing of one scan
+	digitalTouchEnergyMeasure(&energy, start, 20000, pins, leds);
+	// ... sleep until the next scan
+
+The busy loop takes about DIGITALTOUCH_CYCLES_HARDCODED CPU cycles per count with the hard-coded
+IO functions (sensorx_read ...) and about DIGITALTOUCH_CYCLES_GENERIC cycles with the generic path
+of digitalTouchRead(), see DigitalTouchUnits.h for these constants.
+
+As in the main library, no global variables are used. Times are in us and currents in uA,
+digitalTouchEnergyCharge() returns the charge in nC (uA * ms). On AVR the times are 32 bit: the
+sum of all sensor pins overflows after about 4000s / (pins + leds) (e.g. 16 pins with a period of
+20ms after 13000 scans), read and clear the struct before. On other systems (Linux tools) the
+times are 64 bit.
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+#include "DigitalTouchUnits.h"
+#ifdef ARDUINO
+	#include <Arduino.h>
+#endif
+
+
+// sums of the times, 32 bit on the controller, 64 bit on the host
+#ifdef __AVR__
+	typedef uint32_t DigitalTouchEnergyTime;
+#else
+	typedef uint64_t DigitalTouchEnergyTime;
+#endif
+
+// constants of a board, all currents in uA at the supply voltage
+// e.g. ATmega328P at 16MHz and 5V: { 16, 9000, 5, 5, 3000 } (active, power-down with watchdog,
+// Rp = 1MOhm, LED with 1kOhm), check the data sheet and measure the real board
+struct DigitalTouchBoard {
+	uint8_t mhz;       // CPU clock
+	uint16_t activeUA; // CPU active
+	uint16_t sleepUA;  // CPU sleeping
+	uint16_t pinUA;    // one sensor pin LOW with Rp to Vdd
+	uint16_t ledUA;    // one LED on
+};
+
+// times of the parts, in the main program, start with all zero
+struct DigitalTouchEnergy {
+	DigitalTouchEnergyTime activeUS; // CPU active
+	DigitalTouchEnergyTime sleepUS;  // CPU sleeping
+	DigitalTouchEnergyTime pinUS;    // sum of the times of all sensor pins LOW
+	DigitalTouchEnergyTime ledUS;    // sum of the times of all LEDs on
+	uint32_t scans;
+};
+
+// function digitalTouchEnergyScan
+// adds one scan: "activeUS" of the CPU in a scan period of "periodUS" (the rest is sleep),
+// "pins" sensors are LOW and "leds" LEDs are on for the whole period except the active time
+void digitalTouchEnergyScan(DigitalTouchEnergy *energy, uint32_t activeUS, uint32_t periodUS, uint8_t pins, uint8_t leds)
+{
+	// a scan longer than the period leaves no time for sleep
+	uint32_t sleepUS = periodUS > activeUS ? periodUS - activeUS : 0;
+	energy->activeUS += activeUS;
+	energy->sleepUS += sleepUS;
+	energy->pinUS += (DigitalTouchEnergyTime)pins * sleepUS;
+	energy->ledUS += (DigitalTouchEnergyTime)leds * sleepUS;
+	energy->scans++;
+}
+
+#ifdef ARDUINO
+// function digitalTouchEnergyMeasure
+// adds one scan that started at "startUS" (micros() before the first measurement), the active
+// time lasts until now, see digitalTouchEnergyScan() for the other parameters
+void digitalTouchEnergyMeasure(DigitalTouchEnergy *energy, uint32_t startUS, uint32_t periodUS, uint8_t pins, uint8_t leds)
+{
+	digitalTouchEnergyScan(energy, micros() - startUS, periodUS, pins, leds);
+}
+#endif
+
+// function digitalTouchEnergyCharge
+// charge of all added scans in nC
+DigitalTouchEnergyTime digitalTouchEnergyCharge(const DigitalTouchEnergy *energy, const DigitalTouchBoard *board)
+{
+	// every part in nC, so the sum does not overflow
+	return energy->activeUS / 1000 * board->activeUA + energy->activeUS % 1000 * board->activeUA / 1000
+		+ energy->sleepUS / 1000 * board->sleepUA + energy->sleepUS % 1000 * board->sleepUA / 1000
+		+ energy->pinUS / 1000 * board->pinUA + energy->pinUS % 1000 * board->pinUA / 1000
+		+ energy->ledUS / 1000 * board->ledUA + energy->ledUS % 1000 * board->ledUA / 1000;
+}
+
+// function digitalTouchEnergyCurrent
+// average current of all added scans in uA
+uint32_t digitalTouchEnergyCurrent(const DigitalTouchEnergy *energy, const DigitalTouchBoard *board)
+{
+	DigitalTouchEnergyTime ms = (energy->activeUS + energy->sleepUS) / 1000;
+	if (ms == 0) return 0;
+	return (uint32_t)(digitalTouchEnergyCharge(energy, board) / ms);
+}
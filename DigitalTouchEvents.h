@@ -0,0 +1,235 @@
+/*
+DigitalTouchEvents.h - Touch events, sliders and wheels for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+The functions in this file do not measure anything. They work on the deltas of the sensors
+(digitalTouchDeltas() in DigitalTouch.h), so they are the same for all measurement methods and
+also run on Linux (see extras/linux). As in the main library, no global variables are used:
+the state of every sensor is one byte in the main program.
+
+Events:
+
+digitalTouchEvent() turns the delta of one sensor into PRESS and RELEASE events. A press is only
+reported if the delta is above the threshold for "confirm" scans in a row, a release if it is
+at or below half of the threshold for "confirm" scans (hysteresis). So single outliers that
+passed the filter do not toggle the sensor.
+
+Sliders and wheels:
+
+Some sensors in a row (slider) or in a circle (wheel) give a position with a much higher
+resolution than the number of sensors. digitalTouchSlider() takes the sensor with the highest
+delta and interpolates with its two neighbors (centroid). The result is 0..255 for the whole
+slider or one turn of the wheel.
+
+Intensity and levels:
+
+A bigger contact area (a firm press) gives a bigger delta. digitalTouchIntensityUpdate() learns
+the typical amplitude of a touch from the peaks of the last touches and stores its reciprocal,
+so the intensity of a scan is one multiplication and one shift: 128 is a typical touch, 255 a
+touch of twice the amplitude or more. digitalTouchLevel() turns the intensity into levels
+(e.g. light and firm press) with thresholds and hysteresis and reports DIGITALTOUCH_LEVEL when
+the level changes.
+
+Stuck touches:
+
+A metal object or a wet cloth on a sensor gives a delta above the threshold, so the sensor stays
+touched and the baseline follows only slowly: digitalTouchCalibrate() cools down by one step of
+1/2^offset count per scan, so with offset 4 an object of 10 counts is absorbed after about 160
+scans (the delta then falls below the threshold some scans earlier). A finger never rests
+perfectly still, its delta varies from scan to scan, while the delta of an object is very stable.
+digitalTouchStuck() keeps a running mean and variance of the delta while the sensor is touched,
+the variance starts from the first difference (second scan of the touch). If it is touched for
+"minScans" scans or longer with a variance below "maxVariance", the baseline is set to the
+current value, the sensor is released and DIGITALTOUCH_STUCK is returned, so the application can
+log it. When the object is removed, the value drops below the baseline and the self calibration
+follows immediately.
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+
+// events returned by digitalTouchEvent()
+#define DIGITALTOUCH_NONE    0
+#define DIGITALTOUCH_PRESS   1
+#define DIGITALTOUCH_RELEASE 2
+#define DIGITALTOUCH_LEVEL   3 // returned by digitalTouchLevel()
+#define DIGITALTOUCH_MOVE    4 // contacts of a touchpad, see DigitalTouchPad.h
+#define DIGITALTOUCH_STUCK   5 // returned by digitalTouchStuck()
+
+// bit in the state byte of a sensor that is set while the sensor is touched
+#define DIGITALTOUCH_TOUCHED 0x80
+
+// result of digitalTouchSlider() if no sensor of the slider is touched
+#define DIGITALTOUCH_NO_POSITION -1
+
+// function digitalTouchEvent
+// state machine of one sensor, call it once per scan with the delta of the sensor
+// "state" is one byte per sensor in the main program, start with 0
+// bit 7 is the touch state (DIGITALTOUCH_TOUCHED), bits 0..6 count the scans for the confirmation
+// "confirm" is 1..127, 1 reports every change immediately
+uint8_t digitalTouchEvent(uint8_t *state, int8_t delta, uint8_t threshold, uint8_t confirm)
+{
+	bool touched = *state & DIGITALTOUCH_TOUCHED;
+
+	// does the delta point to the other state? (hysteresis: release at half threshold)
+	bool change = touched ? (delta <= (int8_t)(threshold >> 1)) : (delta > (int8_t)threshold);
+	if (!change) {
+		*state &= DIGITALTOUCH_TOUCHED;
+		return DIGITALTOUCH_NONE;
+	}
+
+	// count the scans, change the state when confirmed
+	uint8_t counter = (*state & ~DIGITALTOUCH_TOUCHED) + 1;
+	if (counter < confirm) {
+		*state = (*state & DIGITALTOUCH_TOUCHED) | counter;
+		return DIGITALTOUCH_NONE;
+	}
+	*state = touched ? 0 : DIGITALTOUCH_TOUCHED;
+	return touched ? DIGITALTOUCH_RELEASE : DIGITALTOUCH_PRESS;
+}
+
+// function digitalTouchSlider
+// position of a finger on "count" sensors in a row (wheel = false) or in a circle (wheel = true)
+// returns 0..255, or DIGITALTOUCH_NO_POSITION if no delta is above the threshold
+// For a slider 0 is the center of the first and 255 the center of the last sensor. For a wheel
+// 0 is the center of the first sensor, one turn is 256, so the position wraps around.
+int16_t digitalTouchSlider(const int8_t *deltas, uint8_t count, int8_t threshold, bool wheel)
+{
+	if (count < 2) return DIGITALTOUCH_NO_POSITION;
+
+	// find the sensor with the highest delta
+	uint8_t top = 0;
+	for (uint8_t i = 1; i < count; i++) {
+		if (deltas[i] > deltas[top]) top = i;
+	}
+	if (deltas[top] <= threshold) return DIGITALTOUCH_NO_POSITION;
+
+	// neighbors, negative deltas do not count
+	int8_t left = 0;
+	int8_t right = 0;
+	if (top > 0) left = deltas[top - 1];
+	else if (wheel) left = deltas[count - 1];
+	if (top < count - 1) right = deltas[top + 1];
+	else if (wheel) right = deltas[0];
+	if (left < 0) left = 0;
+	if (right < 0) right = 0;
+
+	// centroid in 1/256 of the sensor distance
+	int16_t sum = (int16_t)left + deltas[top] + right;
+	int16_t position = ((int16_t)top << 8) + (int16_t)((((int32_t)right - left) << 8) / sum);
+
+	if (wheel) {
+		// one turn is count * 256, scale it to 256
+		if (position < 0) position += (int16_t)count << 8;
+		return (int16_t)(((uint16_t)position / count) & 0xFF);
+	}
+
+	// the ends of the slider are the centers of the first and the last sensor
+	int16_t last = (int16_t)(count - 1) << 8;
+	if (position < 0) position = 0;
+	if (position > last) position = last;
+	return (int16_t)(((int32_t)position * 255) / last);
+}
+
+// intensity of one sensor, in the main program, start with { 0, 0, 0 }
+struct DigitalTouchIntensity {
+	uint16_t scale;    // 32768 / amplitude, 0 while no touch was learned
+	uint8_t amplitude; // typical peak delta of a touch
+	uint8_t peak;      // peak delta of the current touch
+};
+
+// function digitalTouchIntensityUpdate
+// learns the typical amplitude of a touch, call it once per scan after digitalTouchEvent()
+// the peak of every touch moves the amplitude 1/4 towards it at the release, so a single firm
+// press does not change the scale of the following touches much
+void digitalTouchIntensityUpdate(DigitalTouchIntensity *intensity, int8_t delta, uint8_t state)
+{
+	if (state & DIGITALTOUCH_TOUCHED) {
+		if (delta > (int8_t)intensity->peak) intensity->peak = (uint8_t)delta;
+		return;
+	}
+	if (intensity->peak == 0) return;
+
+	// touch released, learn its peak
+	if (intensity->amplitude == 0) intensity->amplitude = intensity->peak;
+	else intensity->amplitude = (uint8_t)((int16_t)intensity->amplitude + (((int16_t)intensity->peak - intensity->amplitude) >> 2));
+	if (intensity->amplitude == 0) intensity->amplitude = 1;
+	intensity->scale = (uint16_t)(32768UL / intensity->amplitude);
+	intensity->peak = 0;
+}
+
+// function digitalTouchIntensity
+// normalized intensity of a delta, 128 = typical touch, saturated to 0..255
+uint8_t digitalTouchIntensity(const DigitalTouchIntensity *intensity, int8_t delta)
+{
+	if (delta <= 0) return 0;
+	uint32_t value = ((uint32_t)(uint8_t)delta * intensity->scale) >> 8;
+	return value > 255 ? 255 : (uint8_t)value;
+}
+
+// function digitalTouchLevel
+// level of an intensity, "level" is one byte per sensor in the main program (start with 0)
+// "thresholds" are "count" intensities in ascending order, level n is reached above
+// thresholds[n - 1] and left at or below thresholds[n - 1] - hysteresis
+// returns DIGITALTOUCH_LEVEL if the level changed, DIGITALTOUCH_NONE otherwise
+uint8_t digitalTouchLevel(uint8_t *level, uint8_t intensity, const uint8_t *thresholds, uint8_t count, uint8_t hysteresis)
+{
+	uint8_t old = *level;
+	while (*level < count && intensity > thresholds[*level]) (*level)++;
+	while (*level > 0 && (int16_t)intensity <= (int16_t)thresholds[*level - 1] - hysteresis) (*level)--;
+	return *level != old ? DIGITALTOUCH_LEVEL : DIGITALTOUCH_NONE;
+}
+
+// statistics of a touched sensor for digitalTouchStuck(), in the main program, start with all zero
+struct DigitalTouchStuckState {
+	int16_t mean;      // running mean of the delta, 1/16 count
+	uint16_t variance; // running variance of the delta, 1/16 count^2
+	uint16_t scans;    // scans since the touch started
+};
+
+// function digitalTouchStuck
+// detects a static object on a sensor, call it once per scan after digitalTouchEvent()
+// "value" is the filtered value of this scan, "ref" the baseline with "offset" (see
+// digitalTouchCalibrate()), "state" the state byte of digitalTouchEvent()
+// mean and variance move 1/8 per scan (one multiplication), e.g. maxVariance = 4 (1/4 count^2)
+// the variance starts with the square difference of the second scan, so "minScans" (at least 2)
+// is the real minimum time, use 8 or more scans for a stable estimate
+// returns DIGITALTOUCH_STUCK if the baseline was reset, DIGITALTOUCH_NONE otherwise
+uint8_t digitalTouchStuck(DigitalTouchStuckState *stuck, int8_t delta, uint8_t value, uint8_t *state, uint16_t *ref, uint8_t offset, uint16_t minScans, uint16_t maxVariance)
+{
+	if (!(*state & DIGITALTOUCH_TOUCHED)) {
+		stuck->scans = 0;
+		return DIGITALTOUCH_NONE;
+	}
+
+	// first scan of the touch: start with the current delta, no variance yet
+	int16_t sample = (int16_t)delta << 4;
+	if (stuck->scans == 0) {
+		stuck->mean = sample;
+		stuck->variance = 0xFFFF;
+		stuck->scans = 1;
+		return DIGITALTOUCH_NONE;
+	}
+	if (stuck->scans < 0xFFFF) stuck->scans++;
+
+	// running mean and variance, the difference is limited to +-63 counts (1/4 count resolution)
+	int16_t diff = (sample - stuck->mean) >> 2;
+	if (diff > 255) diff = 255;
+	if (diff < -255) diff = -255;
+	stuck->mean += (sample - stuck->mean) >> 3;
+	uint16_t square = (uint16_t)(diff * diff);
+	if (stuck->scans == 2) stuck->variance = square;
+	else stuck->variance = (uint16_t)((int32_t)stuck->variance + (((int32_t)square - stuck->variance) >> 3));
+
+	if (stuck->scans < minScans || stuck->variance > maxVariance) return DIGITALTOUCH_NONE;
+
+	// static object: the current value is the new baseline, the sensor is released
+	*ref = (uint16_t)value << offset;
+	*state = 0;
+	stuck->scans = 0;
+	return DIGITALTOUCH_STUCK;
+}
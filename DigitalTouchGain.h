@@ -0,0 +1,214 @@
+/*
+DigitalTouchGain.h - Automatic gain control and sensitivity modes for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+Sensors of different size on the same board give very different deltas: a large pad gives a
+clear delta with a single sample, a small pad needs many samples. With one number of samples
+for all sensors, the small pads are too insensitive or the large pads waste measurement time.
+
+The automatic gain control (AGC) adapts the number of samples of every sensor, so that a touch
+gives about "target" counts. The sensor is read with digitalTouchSum() (DigitalTouch.h), the
+sum of the samples, so the delta grows with the number of samples. The gain is learned from
+real touches: while a sensor is touched (DIGITALTOUCH_TOUCHED, see DigitalTouchEvents.h), the
+delta is averaged into "amplitude". After the release the number of samples is set to reach the
+target, and the baseline is scaled by the same factor, so no new calibration is needed.
+The number of samples is limited so that the baseline plus a touch fits into 8 bits, and
+digitalTouchGainLimit() reduces the sensors with the most samples until the whole scan fits into
+a budget of samples (scan time). The deltas are 8 bit, so the target should be 10..100 counts.
+
+Usage, one DigitalTouchGain per sensor in the main program, start with { 1, 0 }:
+
+	values[i] = digitalTouchSum(pins[i], gains[i].samples);
+	...  deltas, events
+	digitalTouchGainUpdate(&gains[i], deltas[i], states[i], &refs[i], offset, target, maxSamples);
+	...  after all sensors
+	digitalTouchGainLimit(gains, refs, count, offset, budget);
+
+Sensitivity modes (gloves, wet fingers):
+
+A finger in a glove or a wet finger gives a delta below the threshold, but a consistent one. The
+sensitivity mode switches the whole keypad into a glove profile when a sensor shows such a
+"candidate" delta (between the glove threshold and the normal threshold) for "enter" scans in a
+row, and back into the normal profile after "timeout" scans without any activity. The glove
+profile has a lower threshold, more samples and more confirmation scans. Only the sensors with
+candidate activity or a touch (delta of the last scan over the glove threshold) get the higher
+number of samples, all others keep the samples of the normal profile, so the scan time stays
+almost the same. The profiles are made for digitalTouchAverage() (the thresholds do not depend on
+the samples), "deltas" are those of the last scan here:
+
+	values[i] = digitalTouchAverage(pins[i], digitalTouchSensitivitySamples(&mode, candidates[i], deltas[i]));
+	...  deltas
+	digitalTouchSensitivityUpdate(&mode, deltas, candidates, count);
+	digitalTouchEvent(&states[i], deltas[i], mode.active->threshold, mode.active->confirm);
+
+As in the main library, no global variables are used.
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+#include "DigitalTouchEvents.h"
+
+// state of the gain control of one sensor
+struct DigitalTouchGain {
+	uint8_t samples;   // number of samples for digitalTouchSum(), 1..255
+	uint8_t amplitude; // learned delta of a touch with this number of samples, 0 = no touch yet
+};
+
+// function digitalTouchGainSet
+// changes the number of samples of a sensor and scales its baseline "ref" (with "offset"
+// additional bits, see digitalTouchCalibrate()) and the learned amplitude by the same factor
+void digitalTouchGainSet(DigitalTouchGain *gain, uint16_t *ref, uint8_t offset, uint8_t samples)
+{
+	if (samples == 0) samples = 1;
+	if (samples == gain->samples) return;
+
+	// baseline, 0xFFFF is not calibrated yet
+	if (*ref != 0xFFFF) {
+		uint32_t scaled = ((uint32_t)*ref * samples) / gain->samples;
+		uint32_t limit = (uint32_t)255 << offset;
+		*ref = (uint16_t)(scaled > limit ? limit : scaled);
+	}
+
+	uint16_t amplitude = ((uint16_t)gain->amplitude * samples) / gain->samples;
+	gain->amplitude = amplitude > 255 ? 255 : (uint8_t)amplitude;
+	gain->samples = samples;
+}
+
+// function digitalTouchGainUpdate
+// learns the amplitude of a touch and adapts the number of samples, call it once per scan after
+// digitalTouchEvent() with the delta and the state of the sensor
+// The number of samples only changes while the sensor is not touched and if the amplitude is
+// outside of 3/4..3/2 of the target, so it does not oscillate. "maxSamples" limits the samples
+// of this sensor, the baseline is scaled (see digitalTouchGainSet()).
+// returns true if the number of samples was changed
+bool digitalTouchGainUpdate(DigitalTouchGain *gain, int8_t delta, uint8_t state, uint16_t *ref, uint8_t offset, uint8_t target, uint8_t maxSamples)
+{
+	// learn the amplitude while touched, 1/4 step per scan
+	if (state & DIGITALTOUCH_TOUCHED) {
+		if (delta > 0) {
+			if (gain->amplitude == 0) gain->amplitude = (uint8_t)delta;
+			else gain->amplitude = (uint8_t)((int16_t)gain->amplitude + (((int16_t)delta - gain->amplitude) >> 2));
+		}
+		return false;
+	}
+	if (gain->amplitude == 0) return false;
+
+	// amplitude in the range of the target?
+	uint16_t amplitude = gain->amplitude;
+	if (amplitude * 4 >= (uint16_t)target * 3 && amplitude * 2 <= (uint16_t)target * 3) return false;
+
+	// number of samples for the target (rounded)
+	uint16_t samples = ((uint16_t)gain->samples * target + (amplitude >> 1)) / amplitude;
+	if (samples > maxSamples) samples = maxSamples;
+
+	// baseline and touch must fit into 8 bits
+	if (*ref != 0xFFFF) {
+		uint16_t baseline = ((*ref >> offset) + gain->samples - 1) / gain->samples;
+		while (samples > 1 && baseline * samples + target > 255) samples--;
+	}
+	if (samples < 1) samples = 1;
+	if (samples == gain->samples) return false;
+
+	digitalTouchGainSet(gain, ref, offset, (uint8_t)samples);
+	return true;
+}
+
+// function digitalTouchGainLimit
+// limits the total number of samples of "count" sensors (the scan time) to "budget"
+// the sensor with the most samples loses one sample per step, so the budget is shared evenly
+// and no sensor drops to a low gain while others keep many samples
+// returns the total number of samples per scan
+uint16_t digitalTouchGainLimit(DigitalTouchGain *gains, uint16_t *refs, uint8_t count, uint8_t offset, uint16_t budget)
+{
+	uint16_t total = 0;
+	for (uint8_t i = 0; i < count; i++) total += gains[i].samples;
+
+	while (total > budget) {
+		// sensor with the most samples
+		uint8_t top = 0;
+		for (uint8_t i = 1; i < count; i++) {
+			if (gains[i].samples > gains[top].samples) top = i;
+		}
+		if (gains[top].samples <= 1) break;
+		digitalTouchGainSet(&gains[top], &refs[top], offset, gains[top].samples - 1);
+		total--;
+	}
+	return total;
+}
+
+// profile of a sensitivity mode
+struct DigitalTouchProfile {
+	uint8_t threshold; // threshold for digitalTouchEvent()
+	uint8_t confirm;   // confirmation scans for digitalTouchEvent()
+	uint8_t samples;   // samples for digitalTouchAverage()
+};
+
+// state of the sensitivity mode of a keypad
+// start with { &normal, &glove, &normal, enter, timeout, 0 }
+struct DigitalTouchSensitivity {
+	const DigitalTouchProfile *normal;
+	const DigitalTouchProfile *glove;
+	const DigitalTouchProfile *active; // the profile in use
+	uint8_t enter;                     // scans with candidate delta that switch to the glove profile
+	uint16_t timeout;                  // scans without activity that switch back
+	uint16_t idle;                     // scans without activity in the glove profile
+};
+
+// function digitalTouchSensitivitySamples
+// number of samples for a sensor with the "candidate" counter of digitalTouchSensitivityUpdate()
+// and the "delta" of the last scan: sensors with candidate activity and, in the glove profile,
+// touched sensors are oversampled with the samples of the glove profile, all others get the
+// samples of the normal profile
+uint8_t digitalTouchSensitivitySamples(const DigitalTouchSensitivity *mode, uint8_t candidate, int8_t delta)
+{
+	if (candidate) return mode->glove->samples;
+	if (mode->active == mode->glove && delta > (int8_t)mode->glove->threshold) return mode->glove->samples;
+	return mode->normal->samples;
+}
+
+// function digitalTouchSensitivityUpdate
+// counts the candidate scans of "count" sensors and switches the profile, call it once per scan
+// "candidates" is one byte per sensor in the main program (start with 0)
+// returns true if the profile was changed
+bool digitalTouchSensitivityUpdate(DigitalTouchSensitivity *mode, const int8_t *deltas, uint8_t *candidates, uint8_t count)
+{
+	int8_t low = (int8_t)mode->glove->threshold;
+	int8_t high = (int8_t)mode->normal->threshold;
+	bool active = false;
+	bool enter = false;
+
+	for (uint8_t i = 0; i < count; i++) {
+		int8_t delta = deltas[i];
+		if (delta > low) active = true;
+
+		// candidate: consistent delta below the normal threshold (a normal touch is no candidate)
+		if (delta > low && delta <= high) {
+			if (candidates[i] < 255) candidates[i]++;
+			if (candidates[i] >= mode->enter) enter = true;
+		} else if (delta <= (int8_t)(low >> 1) || delta > high) {
+			// hysteresis like digitalTouchEvent()
+			candidates[i] = 0;
+		}
+	}
+
+	if (mode->active == mode->normal) {
+		if (!enter) return false;
+		mode->active = mode->glove;
+		mode->idle = 0;
+		return true;
+	}
+
+	// back to the normal profile after the timeout
+	if (active) {
+		mode->idle = 0;
+		return false;
+	}
+	if (++mode->idle < mode->timeout) return false;
+	mode->active = mode->normal;
+	for (uint8_t i = 0; i < count; i++) candidates[i] = 0;
+	return true;
+}
@@ -0,0 +1,365 @@
+/*
+DigitalTouchI2C.h - Touch controller firmware mode for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+A small controller (e.g. ATTINY85) running DigitalTouch can work as touch controller chip for
+a host controller. This file makes it an I2C slave with a fixed register map, see example
+I2CTouchController. The host reads the touch state only when the change interrupt line tells
+it, so it does not need to poll the bus.
+
+Register map (all multi-byte registers LSB first, the register pointer increments after every
+byte, so a block can be read in one transfer):
+
+0x00 STATUS   2 bytes  status/fault word, see DIGITALTOUCH_STATUS_*
+0x02 TOUCHED  2 bytes  bit mask of touched sensors (bit 0 = first sensor)
+                       reading the first byte clears the change flag and releases the IRQ line
+0x04 COUNT    1 byte   number of sensors
+0x05 VERSION  1 byte   DIGITALTOUCH_VERSION
+0x10 CONFIG   n bytes  configuration of the main program (thresholds, samples, ...), read/write
+0x40 DELTAS   n bytes  delta of every sensor (int8_t)
+other addresses read as 0, writing is only possible to CONFIG
+
+The deltas and the configuration are not copied: the registers read directly from the arrays
+of the main program (the ones given to digitalTouchDeltas() and used by the scan). Only the
+touch mask and the status are kept in the register map itself. A register read is a few
+compares and one memory access, so it is fast enough for an interrupt routine.
+
+Bus interface:
+
+digitalTouchI2CReceive() and digitalTouchI2CTransmit() handle one byte each. They do not
+depend on the hardware, so they can be connected to any I2C slave implementation or to a bus
+simulation on a PC (extras/linux/touchi2c checks the register map this way). On controllers with TWI (ATmega) or USI (ATTINY25/45/85, ATTINY24/44/84)
+digitalTouchI2CBegin() sets up the hardware and an interrupt routine calls them.
+Do not use the Wire library (or another one using the TWI/USI interrupts) at the same time.
+
+Include this file after DigitalTouch.h.
+The measuring loops of the library block the interrupts for a short time. The TWI and USI
+hardware hold SCL low until the interrupt routine has handled a byte (clock stretching), so the
+host just waits a bit longer.
+
+Change interrupt:
+
+Define changeIrq_assert and changeIrq_release in the main program before including this file.
+The line is active low (open drain), e.g. for PB3:
+#define changeIrq_assert  digitalTouchSetBit(DDRB, 3)    // output, PORTB3 stays LOW
+#define changeIrq_release digitalTouchClearBit(DDRB, 3)  // input, pulled up by the host
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+
+// registers
+#define DIGITALTOUCH_REG_STATUS  0x00
+#define DIGITALTOUCH_REG_TOUCHED 0x02
+#define DIGITALTOUCH_REG_COUNT   0x04
+#define DIGITALTOUCH_REG_VERSION 0x05
+#define DIGITALTOUCH_REG_CONFIG  0x10
+#define DIGITALTOUCH_REG_DELTAS  0x40
+
+// bits of the status/fault word
+#define DIGITALTOUCH_STATUS_CHANGE   0x0001 // touch state changed since the last read of TOUCHED
+#define DIGITALTOUCH_STATUS_OVERFLOW 0x0002 // a sensor counter overflowed (no Rp, short circuit, ...)
+#define DIGITALTOUCH_STATUS_CONFIG   0x0004 // CONFIG written by the host, cleared by the main program
+
+// the interrupt routine and the main program share the register map
+#ifdef ARDUINO
+	#define digitalTouchI2CLock()   noInterrupts()
+	#define digitalTouchI2CUnlock() interrupts()
+#else
+	#define digitalTouchI2CLock()
+	#define digitalTouchI2CUnlock()
+#endif
+
+// register map, one instance in the main program
+struct DigitalTouchI2CMap {
+	const int8_t *deltas;     // delta array of the scan, "count" bytes
+	uint8_t *config;          // configuration array of the main program, "configSize" bytes
+	uint8_t count;            // number of sensors
+	uint8_t configSize;       // number of configuration bytes (up to 0x30)
+	volatile uint16_t touched; // set by digitalTouchI2CUpdate()
+	volatile uint16_t status;  // DIGITALTOUCH_STATUS_*
+	uint8_t pointer;          // register pointer of the bus
+	uint8_t latch;            // upper byte of STATUS or TOUCHED, latched when the lower byte is read
+};
+
+// the map used by the bus interface
+static DigitalTouchI2CMap *digitalTouchI2CRegisters = 0;
+
+// function digitalTouchI2CRead
+// returns the register at address "reg", used by digitalTouchI2CTransmit()
+uint8_t digitalTouchI2CRead(DigitalTouchI2CMap *map, uint8_t reg)
+{
+	if (reg >= DIGITALTOUCH_REG_DELTAS) {
+		reg -= DIGITALTOUCH_REG_DELTAS;
+		return reg < map->count ? (uint8_t)map->deltas[reg] : 0;
+	}
+	if (reg >= DIGITALTOUCH_REG_CONFIG) {
+		reg -= DIGITALTOUCH_REG_CONFIG;
+		return reg < map->configSize ? map->config[reg] : 0;
+	}
+	switch (reg) {
+		case DIGITALTOUCH_REG_STATUS:
+			map->latch = (uint8_t)(map->status >> 8);
+			return (uint8_t)map->status;
+		case DIGITALTOUCH_REG_TOUCHED: {
+			uint16_t touched = map->touched;
+			map->latch = (uint8_t)(touched >> 8);
+			// the host got the new state
+			map->status &= ~DIGITALTOUCH_STATUS_CHANGE;
+			#ifdef changeIrq_release
+				changeIrq_release;
+			#endif
+			return (uint8_t)touched;
+		}
+		case DIGITALTOUCH_REG_STATUS + 1:
+		case DIGITALTOUCH_REG_TOUCHED + 1:
+			return map->latch;
+		case DIGITALTOUCH_REG_COUNT:
+			return map->count;
+		case DIGITALTOUCH_REG_VERSION:
+			return DIGITALTOUCH_VERSION;
+	}
+	return 0;
+}
+
+// function digitalTouchI2CReceive
+// handles one byte written by the host, "first" is true for the first byte of a transfer
+// the first byte sets the register pointer, all following bytes are written to CONFIG
+void digitalTouchI2CReceive(uint8_t data, bool first)
+{
+	DigitalTouchI2CMap *map = digitalTouchI2CRegisters;
+	if (!map) return;
+	if (first) {
+		map->pointer = data;
+		return;
+	}
+	uint8_t reg = map->pointer - DIGITALTOUCH_REG_CONFIG;
+	if (map->pointer >= DIGITALTOUCH_REG_CONFIG && reg < map->configSize) {
+		map->config[reg] = data;
+		map->status |= DIGITALTOUCH_STATUS_CONFIG;
+	}
+	map->pointer++;
+}
+
+// function digitalTouchI2CTransmit
+// returns the next byte read by the host
+uint8_t digitalTouchI2CTransmit()
+{
+	DigitalTouchI2CMap *map = digitalTouchI2CRegisters;
+	if (!map) return 0;
+	return digitalTouchI2CRead(map, map->pointer++);
+}
+
+// function digitalTouchI2CUpdate
+// call it once per scan with the new touch mask and the overflow state of the sensors
+// if the touch state changed, the change flag is set and the IRQ line is asserted
+void digitalTouchI2CUpdate(DigitalTouchI2CMap *map, uint16_t touched, bool overflow)
+{
+	digitalTouchI2CLock();
+	if (touched != map->touched) {
+		map->touched = touched;
+		map->status |= DIGITALTOUCH_STATUS_CHANGE;
+		#ifdef changeIrq_assert
+			changeIrq_assert;
+		#endif
+	}
+	if (overflow) map->status |= DIGITALTOUCH_STATUS_OVERFLOW;
+	else map->status &= ~DIGITALTOUCH_STATUS_OVERFLOW;
+	digitalTouchI2CUnlock();
+}
+
+// function digitalTouchI2CConfigChanged
+// returns true once after the host has written to CONFIG, so the main program can apply it
+bool digitalTouchI2CConfigChanged(DigitalTouchI2CMap *map)
+{
+	digitalTouchI2CLock();
+	bool changed = map->status & DIGITALTOUCH_STATUS_CONFIG;
+	map->status &= ~DIGITALTOUCH_STATUS_CONFIG;
+	digitalTouchI2CUnlock();
+	return changed;
+}
+
+
+#if defined(ARDUINO) && defined(TWCR)
+// TWI slave (ATmega)
+
+// function digitalTouchI2CBegin
+// starts the I2C slave with the 7 bit "address" and the register map
+void digitalTouchI2CBegin(DigitalTouchI2CMap *map, uint8_t address)
+{
+	digitalTouchI2CRegisters = map;
+	#ifdef changeIrq_release
+		changeIrq_release;
+	#endif
+	TWAR = address << 1;
+	TWCR = _BV(TWEN) | _BV(TWEA) | _BV(TWIE) | _BV(TWINT);
+}
+
+// first byte of a write transfer
+static bool digitalTouchI2CFirst;
+
+ISR(TWI_vect)
+{
+	switch (TWSR & 0xF8) {
+		case 0x60: // own address + write received
+		case 0x68:
+			digitalTouchI2CFirst = true;
+			break;
+		case 0x80: // data received
+			digitalTouchI2CReceive(TWDR, digitalTouchI2CFirst);
+			digitalTouchI2CFirst = false;
+			break;
+		case 0xA8: // own address + read received
+		case 0xB0:
+		case 0xB8: // data sent, ACK received
+			TWDR = digitalTouchI2CTransmit();
+			break;
+		case 0x00: // bus error
+			TWCR = _BV(TWEN) | _BV(TWEA) | _BV(TWIE) | _BV(TWINT) | _BV(TWSTO);
+			return;
+	}
+	// STOP, NACK and all other states: just continue listening
+	TWCR = _BV(TWEN) | _BV(TWEA) | _BV(TWIE) | _BV(TWINT);
+}
+
+#elif defined(ARDUINO) && defined(USICR)
+// USI slave (ATTINY), based on the state machine of Atmel application note AVR312
+
+#if defined(__AVR_ATtiny25__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
+	#define DIGITALTOUCH_USI_DDR DDRB
+	#define DIGITALTOUCH_USI_PORT PORTB
+	#define DIGITALTOUCH_USI_PIN PINB
+	#define DIGITALTOUCH_USI_SDA 0
+	#define DIGITALTOUCH_USI_SCL 2
+#elif defined(__AVR_ATtiny24__) || defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__)
+	#define DIGITALTOUCH_USI_DDR DDRA
+	#define DIGITALTOUCH_USI_PORT PORTA
+	#define DIGITALTOUCH_USI_PIN PINA
+	#define DIGITALTOUCH_USI_SDA 6
+	#define DIGITALTOUCH_USI_SCL 4
+#elif !defined(DIGITALTOUCH_USI_DDR)
+	#error "DigitalTouchI2C: define DIGITALTOUCH_USI_DDR/PORT/PIN/SDA/SCL for this controller"
+#endif
+
+#ifndef USI_START_vect
+	#define USI_START_vect USI_STR_vect
+#endif
+
+// states of the USI state machine
+#define DIGITALTOUCH_USI_ADDRESS      0
+#define DIGITALTOUCH_USI_SEND         1
+#define DIGITALTOUCH_USI_SEND_ACK     2
+#define DIGITALTOUCH_USI_CHECK_ACK    3
+#define DIGITALTOUCH_USI_RECEIVE      4
+#define DIGITALTOUCH_USI_RECEIVE_ACK  5
+
+static uint8_t digitalTouchI2CAddress;
+static uint8_t digitalTouchI2CState;
+static bool digitalTouchI2CFirst;
+
+// USI status register values: clear all flags, counter for 8 bits (16 edges) or 1 bit (2 edges)
+#define DIGITALTOUCH_USI_BYTE (_BV(USISIF) | _BV(USIOIF) | _BV(USIPF) | _BV(USIDC))
+#define DIGITALTOUCH_USI_BIT  (_BV(USIOIF) | _BV(USIPF) | _BV(USIDC) | (0x0E << USICNT0))
+
+// wait for the next start condition
+#define digitalTouchI2CWaitStart() \
+	do { \
+		USICR = _BV(USISIE) | _BV(USIWM1) | _BV(USICS1); \
+		USISR = _BV(USIOIF) | _BV(USIPF) | _BV(USIDC); \
+	} while (0)
+
+// function digitalTouchI2CBegin
+// starts the I2C slave with the 7 bit "address" and the register map
+void digitalTouchI2CBegin(DigitalTouchI2CMap *map, uint8_t address)
+{
+	digitalTouchI2CRegisters = map;
+	digitalTouchI2CAddress = address;
+	#ifdef changeIrq_release
+		changeIrq_release;
+	#endif
+	digitalTouchSetBit(DIGITALTOUCH_USI_PORT, DIGITALTOUCH_USI_SCL);
+	digitalTouchSetBit(DIGITALTOUCH_USI_PORT, DIGITALTOUCH_USI_SDA);
+	digitalTouchSetBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SCL);
+	digitalTouchClearBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+	USICR = _BV(USISIE) | _BV(USIWM1) | _BV(USICS1);
+	USISR = 0xF0;
+}
+
+ISR(USI_START_vect)
+{
+	digitalTouchI2CState = DIGITALTOUCH_USI_ADDRESS;
+	digitalTouchClearBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+
+	// wait until SCL is LOW (start complete) or SDA is HIGH (stop)
+	while ((DIGITALTOUCH_USI_PIN & _BV(DIGITALTOUCH_USI_SCL)) && !(DIGITALTOUCH_USI_PIN & _BV(DIGITALTOUCH_USI_SDA)));
+
+	if (!(DIGITALTOUCH_USI_PIN & _BV(DIGITALTOUCH_USI_SDA))) {
+		// start: hold SCL low after each byte until the overflow interrupt has handled it
+		USICR = _BV(USISIE) | _BV(USIOIE) | _BV(USIWM1) | _BV(USIWM0) | _BV(USICS1);
+	} else {
+		// stop
+		USICR = _BV(USISIE) | _BV(USIWM1) | _BV(USICS1);
+	}
+	USISR = DIGITALTOUCH_USI_BYTE;
+}
+
+ISR(USI_OVF_vect)
+{
+	switch (digitalTouchI2CState) {
+		case DIGITALTOUCH_USI_ADDRESS:
+			if ((USIDR >> 1) != digitalTouchI2CAddress) {
+				digitalTouchI2CWaitStart();
+				return;
+			}
+			digitalTouchI2CState = (USIDR & 0x01) ? DIGITALTOUCH_USI_SEND : DIGITALTOUCH_USI_RECEIVE;
+			digitalTouchI2CFirst = true;
+			// send ACK
+			USIDR = 0;
+			digitalTouchSetBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+			USISR = DIGITALTOUCH_USI_BIT;
+			return;
+
+		case DIGITALTOUCH_USI_CHECK_ACK:
+			// NACK from the host: end of transfer
+			if (USIDR) {
+				digitalTouchI2CWaitStart();
+				return;
+			}
+			// falls through, send the next byte
+		case DIGITALTOUCH_USI_SEND:
+			USIDR = digitalTouchI2CTransmit();
+			digitalTouchI2CState = DIGITALTOUCH_USI_SEND_ACK;
+			digitalTouchSetBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+			USISR = DIGITALTOUCH_USI_BYTE & ~_BV(USISIF);
+			return;
+
+		case DIGITALTOUCH_USI_SEND_ACK:
+			// read ACK/NACK of the host
+			digitalTouchI2CState = DIGITALTOUCH_USI_CHECK_ACK;
+			USIDR = 0;
+			digitalTouchClearBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+			USISR = DIGITALTOUCH_USI_BIT;
+			return;
+
+		case DIGITALTOUCH_USI_RECEIVE:
+			digitalTouchI2CState = DIGITALTOUCH_USI_RECEIVE_ACK;
+			digitalTouchClearBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+			USISR = DIGITALTOUCH_USI_BYTE & ~_BV(USISIF);
+			return;
+
+		case DIGITALTOUCH_USI_RECEIVE_ACK:
+			digitalTouchI2CReceive(USIDR, digitalTouchI2CFirst);
+			digitalTouchI2CFirst = false;
+			digitalTouchI2CState = DIGITALTOUCH_USI_RECEIVE;
+			// send ACK
+			USIDR = 0;
+			digitalTouchSetBit(DIGITALTOUCH_USI_DDR, DIGITALTOUCH_USI_SDA);
+			USISR = DIGITALTOUCH_USI_BIT;
+			return;
+	}
+}
+#endif
@@ -0,0 +1,176 @@
+/*
+DigitalTouchLog.h - Event log in EEPROM for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+If a device reports phantom touches in the field, the log shows what happened before: touch
+events, faults (overflow, stuck sensor), baseline resets and noise alarms with a timestamp.
+The log is a ring in a part of the EEPROM ("size" records of 4 bytes from "start"), the oldest
+records are overwritten, so every cell is written once per turn of the ring (wear leveling).
+
+Record (4 bytes):
+	byte 0: bit 7 lap (toggles every turn of the ring), bits 6..4 type, bits 3..0 sensor
+	byte 1: data (delta, value or boot counter)
+	byte 2, 3: time, low byte first (e.g. millis() >> 10, about seconds, wraps after 18 hours)
+An erased cell (0xFF) is a record of type 7 and marks the end of a new log. After a reset the end
+of the log is the first record with another lap bit than the first record.
+
+digitalTouchLogAdd() only copies the record into a buffer in RAM, so it can be called in the
+scan. digitalTouchLogWrite() writes one byte if the EEPROM is ready and never waits, call it in
+the main loop. It starts when DIGITALTOUCH_LOG_BATCH records are buffered, or all at once with
+flush = true (e.g. before sleep). If the buffer is full, new records are dropped and counted.
+
+The log can be read with avrdude (-U eeprom:r:log.bin:r) and decoded with extras/linux/touchlog.
+The EEPROM access can be replaced (e.g. by flash) by defining digitalTouchLogReadByte(address),
+digitalTouchLogWriteByte(address, value) and digitalTouchLogReady() before the include.
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+
+// EEPROM access
+#ifndef digitalTouchLogReadByte
+	#include <avr/eeprom.h>
+	#define digitalTouchLogReadByte(address)         eeprom_read_byte((const uint8_t *)(uintptr_t)(address))
+	#define digitalTouchLogWriteByte(address, value) eeprom_write_byte((uint8_t *)(uintptr_t)(address), (value))
+	#define digitalTouchLogReady()                   eeprom_is_ready()
+#endif
+
+// records in the RAM buffer
+#ifndef DIGITALTOUCH_LOG_BUFFER
+	#define DIGITALTOUCH_LOG_BUFFER 8
+#endif
+
+// buffered records that start the write
+#ifndef DIGITALTOUCH_LOG_BATCH
+	#define DIGITALTOUCH_LOG_BATCH 4
+#endif
+
+// types of the records
+#define DIGITALTOUCH_LOG_BOOT     0 // data: boot counter
+#define DIGITALTOUCH_LOG_PRESS    1 // data: delta
+#define DIGITALTOUCH_LOG_RELEASE  2 // data: delta
+#define DIGITALTOUCH_LOG_OVERFLOW 3 // data: value (255: no Rp, short circuit)
+#define DIGITALTOUCH_LOG_STUCK    4 // data: delta before the reset (digitalTouchStuck())
+#define DIGITALTOUCH_LOG_BASELINE 5 // data: new baseline
+#define DIGITALTOUCH_LOG_NOISE    6 // data: common mode offset or variance
+#define DIGITALTOUCH_LOG_EMPTY    7 // erased EEPROM
+
+// size of a record in bytes
+#define DIGITALTOUCH_LOG_RECORD 4
+
+// state of the log in the main program, start with { start, size }
+struct DigitalTouchLog {
+	uint16_t start;   // EEPROM address of the first record
+	uint16_t size;    // number of records in the ring
+	uint16_t head;    // next record to write
+	uint8_t lap;      // lap bit of the records of this turn (0x00 or 0x80)
+	uint8_t boot;     // boot counter
+	uint8_t dropped;  // records dropped since the start because the buffer was full
+	uint8_t first;    // oldest record in the buffer
+	uint8_t count;    // records in the buffer
+	uint8_t position; // next byte of the oldest record to write
+	bool flush;       // write all buffered records
+	uint8_t buffer[DIGITALTOUCH_LOG_BUFFER][DIGITALTOUCH_LOG_RECORD];
+};
+
+// function digitalTouchLogFind
+// finds the end of the log (head and lap) and the last boot counter in the EEPROM, used by
+// digitalTouchLogBegin()
+void digitalTouchLogFind(DigitalTouchLog *log)
+{
+	uint8_t first = digitalTouchLogReadByte(log->start);
+	log->head = 0;
+	log->lap = 0;
+	log->boot = 0;
+	if (((first >> 4) & 7) == DIGITALTOUCH_LOG_EMPTY) return;
+
+	// the first record with another lap bit (or an erased record) is the end
+	uint8_t lap = first & 0x80;
+	log->lap = lap ^ 0x80;
+	for (uint16_t i = 1; i < log->size; i++) {
+		uint8_t header = digitalTouchLogReadByte(log->start + i * DIGITALTOUCH_LOG_RECORD);
+		if ((header & 0x80) != lap || ((header >> 4) & 7) == DIGITALTOUCH_LOG_EMPTY) {
+			log->head = i;
+			log->lap = lap;
+			break;
+		}
+	}
+
+	// boot counter of the newest boot record, from the oldest to the newest record
+	for (uint16_t n = 0; n < log->size; n++) {
+		uint16_t i = log->head + n;
+		if (i >= log->size) i -= log->size;
+		uint16_t address = log->start + i * DIGITALTOUCH_LOG_RECORD;
+		if (((digitalTouchLogReadByte(address) >> 4) & 7) == DIGITALTOUCH_LOG_BOOT) log->boot = digitalTouchLogReadByte(address + 1);
+	}
+}
+
+// function digitalTouchLogAdd
+// adds a record to the buffer, returns false if the buffer is full (the record is dropped)
+bool digitalTouchLogAdd(DigitalTouchLog *log, uint8_t type, uint8_t sensor, uint8_t data, uint16_t time)
+{
+	if (log->count >= DIGITALTOUCH_LOG_BUFFER) {
+		if (log->dropped < 255) log->dropped++;
+		return false;
+	}
+	uint8_t index = log->first + log->count;
+	if (index >= DIGITALTOUCH_LOG_BUFFER) index -= DIGITALTOUCH_LOG_BUFFER;
+	uint8_t *record = log->buffer[index];
+	// the lap bit is added when the record is written
+	record[0] = (uint8_t)((type & 7) << 4) | (sensor & 0x0F);
+	record[1] = data;
+	record[2] = (uint8_t)time;
+	record[3] = (uint8_t)(time >> 8);
+	log->count++;
+	return true;
+}
+
+// function digitalTouchLogBegin
+// finds the end of the log and adds a boot record, "start" and "size" must be set
+void digitalTouchLogBegin(DigitalTouchLog *log, uint16_t time)
+{
+	digitalTouchLogFind(log);
+	log->boot++;
+	digitalTouchLogAdd(log, DIGITALTOUCH_LOG_BOOT, 0, log->boot, time);
+}
+
+// function digitalTouchLogWrite
+// writes at most one byte of the buffered records to the EEPROM, call it in the main loop
+// "flush" writes all buffered records, otherwise the write starts with DIGITALTOUCH_LOG_BATCH
+// returns true while records are waiting
+bool digitalTouchLogWrite(DigitalTouchLog *log, bool flush)
+{
+	if (log->count == 0) {
+		log->flush = false;
+		return false;
+	}
+	if (flush) log->flush = true;
+	if (!log->flush && log->position == 0 && log->count < DIGITALTOUCH_LOG_BATCH) return true;
+	if (!digitalTouchLogReady()) return true;
+
+	// start the batch, it is written completely
+	log->flush = true;
+
+	// the header with the lap bit is written last, so an interrupted record is not found as part of
+	// the log after a reset
+	uint8_t index = (log->position + 1) & (DIGITALTOUCH_LOG_RECORD - 1);
+	uint8_t value = log->buffer[log->first][index];
+	if (index == 0) value |= log->lap;
+	digitalTouchLogWriteByte(log->start + log->head * DIGITALTOUCH_LOG_RECORD + index, value);
+
+	// next byte, next record
+	if (++log->position < DIGITALTOUCH_LOG_RECORD) return true;
+	log->position = 0;
+	if (++log->first >= DIGITALTOUCH_LOG_BUFFER) log->first = 0;
+	log->count--;
+	if (++log->head >= log->size) {
+		log->head = 0;
+		log->lap ^= 0x80;
+	}
+	if (log->count == 0) log->flush = false;
+	return log->count != 0;
+}
@@ -0,0 +1,284 @@
+/*
+DigitalTouchPad.h - Touchpad from a grid of sensors for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+A grid of small pads (e.g. 4x4 up to 8x8) gives a touchpad with a position of much higher
+resolution than the pitch of the pads, like the slider in DigitalTouchEvents.h in two dimensions.
+The deltas of the pads (digitalTouchDeltas() in DigitalTouch.h) are a packed array row by row:
+deltas[row * columns + column].
+
+digitalTouchPadPosition() takes the pad with the highest delta and the centroid of its 3x3
+neighborhood. The position is in 1/256 of the pad pitch, 0 is the center of the first pad and
+(columns - 1) * 256 the center of the last pad. Only 16 bit arithmetic and one 16 bit division
+per axis are used, the search for the maximum is one pass over all pads.
+
+digitalTouchPadFilter() smooths the motion: small movements (noise) are filtered strongly and
+fast movements follow with little delay.
+
+The pads of one row can be measured at once with digitalTouchReadPort() (DigitalTouch.h) if they
+are on the same port, an 8x8 grid then needs 8 measurements per sample instead of 64.
+
+Multi-touch:
+
+digitalTouchPadContacts() finds up to DIGITALTOUCH_CONTACTS local maxima (pads with a delta above
+the threshold and not below any of their 8 neighbors) and tracks them over the scans. Every
+contact gets an ID at the first touch, which is kept as long as the contact is found again within
+"maxDistance" of its last position (nearest neighbor). Every contact reports DIGITALTOUCH_PRESS,
+DIGITALTOUCH_MOVE and DIGITALTOUCH_RELEASE (see DigitalTouchEvents.h). The tracker uses no
+dynamic memory, the runtime is linear in the number of pads plus DIGITALTOUCH_CONTACTS^2.
+
+As in the main library, no global variables are used.
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+#include "DigitalTouchEvents.h"
+
+// maximum number of contacts of digitalTouchPadContacts() (1..8), can be defined before the include
+#ifndef DIGITALTOUCH_CONTACTS
+	#define DIGITALTOUCH_CONTACTS 2
+#endif
+
+// position and state of a touchpad in the main program, start with { 0, 0, false }
+struct DigitalTouchPad {
+	int16_t x;    // filtered position, 1/256 of the pad pitch
+	int16_t y;
+	bool touched; // false: x and y are not valid
+};
+
+// function digitalTouchPadAxis
+// centroid of one axis: "center" is the sum of the center row (or column), "before" and "after"
+// the sums of its neighbors, returns the offset to the center in 1/256 of the pitch (-256..256)
+int16_t digitalTouchPadAxis(int16_t before, int16_t center, int16_t after)
+{
+	int16_t sum = before + center + after;
+	int16_t moment = after - before;
+
+	// keep the division in 16 bit: |moment| <= sum < 256 after scaling
+	while (sum > 255) {
+		sum >>= 1;
+		moment >>= 1;
+	}
+	if (sum == 0) return 0;
+	return (int16_t)((moment << 7) / sum) << 1;
+}
+
+// function digitalTouchPadCentroid
+// position of the 3x3 neighborhood of the pad "index" in 1/256 of the pad pitch
+void digitalTouchPadCentroid(const int8_t *deltas, uint8_t columns, uint8_t rows, uint8_t index, int16_t *x, int16_t *y)
+{
+	uint8_t column = index % columns;
+	uint8_t row = index / columns;
+
+	// sums of the columns and rows of the 3x3 neighborhood, negative deltas do not count
+	int16_t columnSum[3] = { 0, 0, 0 };
+	int16_t rowSum[3] = { 0, 0, 0 };
+	for (int8_t dy = -1; dy <= 1; dy++) {
+		int8_t r = (int8_t)row + dy;
+		if (r < 0 || r >= (int8_t)rows) continue;
+		for (int8_t dx = -1; dx <= 1; dx++) {
+			int8_t c = (int8_t)column + dx;
+			if (c < 0 || c >= (int8_t)columns) continue;
+			int8_t delta = deltas[(uint8_t)r * columns + (uint8_t)c];
+			if (delta <= 0) continue;
+			columnSum[dx + 1] += delta;
+			rowSum[dy + 1] += delta;
+		}
+	}
+
+	// centroid, limited to the centers of the outer pads
+	int16_t px = ((int16_t)column << 8) + digitalTouchPadAxis(columnSum[0], columnSum[1], columnSum[2]);
+	int16_t py = ((int16_t)row << 8) + digitalTouchPadAxis(rowSum[0], rowSum[1], rowSum[2]);
+	int16_t lastX = (int16_t)(columns - 1) << 8;
+	int16_t lastY = (int16_t)(rows - 1) << 8;
+	*x = px < 0 ? 0 : (px > lastX ? lastX : px);
+	*y = py < 0 ? 0 : (py > lastY ? lastY : py);
+}
+
+// function digitalTouchPadPosition
+// position of a finger on a grid of "columns" x "rows" pads
+// returns true and the position (1/256 of the pad pitch) in "x" and "y" if the highest delta is
+// above the threshold, false otherwise
+bool digitalTouchPadPosition(const int8_t *deltas, uint8_t columns, uint8_t rows, int8_t threshold, int16_t *x, int16_t *y)
+{
+	// find the pad with the highest delta
+	uint8_t count = columns * rows;
+	uint8_t top = 0;
+	for (uint8_t i = 1; i < count; i++) {
+		if (deltas[i] > deltas[top]) top = i;
+	}
+	if (deltas[top] <= threshold) return false;
+
+	digitalTouchPadCentroid(deltas, columns, rows, top, x, y);
+	return true;
+}
+
+// function digitalTouchPadFilter
+// motion filter, call it once per scan with the result of digitalTouchPadPosition()
+// The first position of a touch is taken directly. Then the filtered position moves 1/2^shift
+// of the distance per scan if the distance is below "jitter" (1/256 of the pitch), otherwise
+// 1/2 of the distance, so noise is suppressed without a delay of fast movements.
+void digitalTouchPadFilter(DigitalTouchPad *pad, bool touched, int16_t x, int16_t y, uint8_t shift, int16_t jitter)
+{
+	if (!touched) {
+		pad->touched = false;
+		return;
+	}
+	if (!pad->touched) {
+		pad->x = x;
+		pad->y = y;
+		pad->touched = true;
+		return;
+	}
+
+	int16_t dx = x - pad->x;
+	int16_t dy = y - pad->y;
+	bool fast = dx > jitter || dx < -jitter || dy > jitter || dy < -jitter;
+	uint8_t step = fast ? 1 : shift;
+	pad->x += dx >> step;
+	pad->y += dy >> step;
+}
+
+// one contact of digitalTouchPadContacts()
+struct DigitalTouchContact {
+	int16_t x;     // position, 1/256 of the pad pitch
+	int16_t y;
+	uint8_t id;    // 0 = free, 1..255
+	uint8_t event; // DIGITALTOUCH_PRESS, DIGITALTOUCH_MOVE, DIGITALTOUCH_RELEASE or DIGITALTOUCH_NONE
+};
+
+// all contacts of a touchpad in the main program, start with all zero
+struct DigitalTouchContacts {
+	DigitalTouchContact contact[DIGITALTOUCH_CONTACTS];
+	uint8_t lastId;
+};
+
+// function digitalTouchPadMaximum
+// true if the pad "index" is a local maximum above the threshold
+// on a plateau of equal deltas only the first pad (row by row) is a maximum
+bool digitalTouchPadMaximum(const int8_t *deltas, uint8_t columns, uint8_t rows, uint8_t index, int8_t threshold)
+{
+	int8_t delta = deltas[index];
+	if (delta <= threshold) return false;
+	uint8_t column = index % columns;
+	uint8_t row = index / columns;
+
+	for (int8_t dy = -1; dy <= 1; dy++) {
+		int8_t r = (int8_t)row + dy;
+		if (r < 0 || r >= (int8_t)rows) continue;
+		for (int8_t dx = -1; dx <= 1; dx++) {
+			int8_t c = (int8_t)column + dx;
+			if (c < 0 || c >= (int8_t)columns || (dx == 0 && dy == 0)) continue;
+			int8_t neighbor = deltas[(uint8_t)r * columns + (uint8_t)c];
+			// neighbors before this pad must be lower, after it not higher
+			if (dy < 0 || (dy == 0 && dx < 0)) {
+				if (neighbor >= delta) return false;
+			} else {
+				if (neighbor > delta) return false;
+			}
+		}
+	}
+	return true;
+}
+
+// function digitalTouchPadContacts
+// finds and tracks the contacts of a touchpad, call it once per scan
+// returns the number of contacts that are touched, the events of this scan are in the contacts
+// A contact is matched to the nearest maximum within "maxDistance" (1/256 of the pad pitch, sum of
+// x and y distance). If there are more maxima than DIGITALTOUCH_CONTACTS, the highest are used.
+uint8_t digitalTouchPadContacts(DigitalTouchContacts *contacts, const int8_t *deltas, uint8_t columns, uint8_t rows, int8_t threshold, int16_t maxDistance)
+{
+	// maxima of this scan, the highest DIGITALTOUCH_CONTACTS
+	uint8_t maxima[DIGITALTOUCH_CONTACTS];
+	uint8_t found = 0;
+	uint8_t count = columns * rows;
+	for (uint8_t i = 0; i < count; i++) {
+		if (!digitalTouchPadMaximum(deltas, columns, rows, i, threshold)) continue;
+		if (found < DIGITALTOUCH_CONTACTS) {
+			maxima[found++] = i;
+			continue;
+		}
+		// replace the lowest maximum
+		uint8_t low = 0;
+		for (uint8_t m = 1; m < DIGITALTOUCH_CONTACTS; m++) {
+			if (deltas[maxima[m]] < deltas[maxima[low]]) low = m;
+		}
+		if (deltas[i] > deltas[maxima[low]]) maxima[low] = i;
+	}
+
+	// positions of the maxima
+	int16_t x[DIGITALTOUCH_CONTACTS];
+	int16_t y[DIGITALTOUCH_CONTACTS];
+	for (uint8_t m = 0; m < found; m++) digitalTouchPadCentroid(deltas, columns, rows, maxima[m], &x[m], &y[m]);
+
+	// contacts released in the last scan are free now, all others are unmatched
+	uint8_t unmatched = 0;
+	for (uint8_t c = 0; c < DIGITALTOUCH_CONTACTS; c++) {
+		DigitalTouchContact *contact = &contacts->contact[c];
+		if (contact->event == DIGITALTOUCH_RELEASE) contact->id = 0;
+		contact->event = DIGITALTOUCH_NONE;
+		if (contact->id) unmatched |= 1 << c;
+	}
+	uint8_t unused = (uint8_t)((1 << found) - 1);
+
+	// nearest neighbor: match the closest pair of contact and maximum first
+	while (unmatched && unused) {
+		int16_t best = maxDistance + 1;
+		uint8_t bestContact = 0;
+		uint8_t bestMaximum = 0;
+		for (uint8_t c = 0; c < DIGITALTOUCH_CONTACTS; c++) {
+			if (!(unmatched & (1 << c))) continue;
+			for (uint8_t m = 0; m < found; m++) {
+				if (!(unused & (1 << m))) continue;
+				int16_t dx = x[m] - contacts->contact[c].x;
+				int16_t dy = y[m] - contacts->contact[c].y;
+				int16_t distance = (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+				if (distance < best) {
+					best = distance;
+					bestContact = c;
+					bestMaximum = m;
+				}
+			}
+		}
+		if (best > maxDistance) break;
+
+		DigitalTouchContact *contact = &contacts->contact[bestContact];
+		if (contact->x != x[bestMaximum] || contact->y != y[bestMaximum]) contact->event = DIGITALTOUCH_MOVE;
+		contact->x = x[bestMaximum];
+		contact->y = y[bestMaximum];
+		unmatched &= ~(1 << bestContact);
+		unused &= ~(1 << bestMaximum);
+	}
+
+	// contacts without maximum are released
+	for (uint8_t c = 0; c < DIGITALTOUCH_CONTACTS; c++) {
+		if (unmatched & (1 << c)) contacts->contact[c].event = DIGITALTOUCH_RELEASE;
+	}
+
+	// maxima without contact are new contacts in the free slots
+	for (uint8_t m = 0; m < found; m++) {
+		if (!(unused & (1 << m))) continue;
+		for (uint8_t c = 0; c < DIGITALTOUCH_CONTACTS; c++) {
+			DigitalTouchContact *contact = &contacts->contact[c];
+			if (contact->id) continue;
+			if (++contacts->lastId == 0) contacts->lastId = 1;
+			contact->id = contacts->lastId;
+			contact->x = x[m];
+			contact->y = y[m];
+			contact->event = DIGITALTOUCH_PRESS;
+			break;
+		}
+	}
+
+	// number of touched contacts
+	uint8_t touched = 0;
+	for (uint8_t c = 0; c < DIGITALTOUCH_CONTACTS; c++) {
+		DigitalTouchContact *contact = &contacts->contact[c];
+		if (contact->id && contact->event != DIGITALTOUCH_RELEASE) touched++;
+	}
+	return touched;
+}
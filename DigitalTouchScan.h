@@ -0,0 +1,158 @@
+/*
+DigitalTouchScan.h - Processing of all sensors of a scan for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+The functions in this file work on the packed delta array of a scan (digitalTouchDeltas() in
+DigitalTouch.h), one byte per sensor. They correct effects that are common to several sensors,
+so they must be called after digitalTouchDeltas() and before the events are evaluated
+(digitalTouchEvent(), digitalTouchSlider() in DigitalTouchEvents.h).
+As in the main library, no global variables are used and the runtime is linear in the number
+of sensors.
+
+Common mode:
+
+If the whole board couples to a noise source (mains, a switching power supply, ...), the values
+of all sensors move together. Each sensor compared with its own baseline then reports a touch.
+digitalTouchCommonMode() estimates this common offset from the sensors that are not touched
+and subtracts it from all sensors. The median is used instead of the average, so a single
+sensor with a real touch (or an outlier) does not influence the estimate. With this correction
+a lower number of samples per sensor gives the same rate of false touches.
+It makes sense with 3 or more sensors on the same board.
+
+Crosstalk:
+
+On keypads with a small pitch, touching one sensor also increases the delta of its neighbors
+(coupling through the traces and the finger). digitalTouchCrosstalk() subtracts the expected
+part from the neighbors, so the thresholds can be lower without ghost keys. The neighbors are an
+explicit list of sensor pairs (a sparse coupling matrix), so a keypad has its horizontal and its
+vertical neighbors and no coupling from the end of one row to the start of the next, e.g. 2x3:
+
+	0 1 2     DigitalTouchNeighbor neighbors[7] = {
+	3 4 5         { 0, 1 }, { 1, 2 }, { 3, 4 }, { 4, 5 },  // rows
+	              { 0, 3 }, { 1, 4 }, { 2, 5 } };           // columns
+
+Every pair has a coupling factor for each direction in 1/65536 of the delta of the touched sensor
+(a large pad next to a small one couples differently from a to b than from b to a), learned by
+digitalTouchCrosstalkLearn(): call it every scan while the user touches each key once (e.g. in a
+calibration mode) and store the list (e.g. in EEPROM).
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+#include "DigitalTouchEvents.h"
+
+// function digitalTouchCommonMode
+// estimates the common offset of all idle sensors and subtracts it from all "count" deltas
+// "states" are the state bytes of digitalTouchEvent(), sensors with DIGITALTOUCH_TOUCHED set are
+// not used for the estimate (NULL: all sensors are used)
+// returns the offset that was subtracted, 0 if less than 2 sensors are idle
+// The median of the idle deltas is found bit by bit: for every bit (starting with the highest) the
+// deltas with the bits found so far are counted, so 8 passes over the array are required and
+// neither sorting nor a copy of the array.
+int8_t digitalTouchCommonMode(int8_t *deltas, uint8_t count, const uint8_t *states)
+{
+	// number of idle sensors
+	uint8_t idle = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		if (!states || !(states[i] & DIGITALTOUCH_TOUCHED)) idle++;
+	}
+	if (idle < 2) return 0;
+
+	// find the lower median (index (idle - 1) / 2 in the sorted list) of the idle deltas
+	// the deltas are compared as unsigned values with inverted sign bit, this keeps the order
+	uint8_t rank = (idle - 1) >> 1;
+	uint8_t median = 0;
+	for (uint8_t bit = 0x80; bit; bit >>= 1) {
+		uint8_t known = (uint8_t)~(uint8_t)((bit << 1) - 1);
+		uint8_t below = 0;
+		for (uint8_t i = 0; i < count; i++) {
+			if (states && (states[i] & DIGITALTOUCH_TOUCHED)) continue;
+			uint8_t value = (uint8_t)deltas[i] ^ 0x80;
+			if ((value & known) == median && !(value & bit)) below++;
+		}
+		if (rank >= below) {
+			rank -= below;
+			median |= bit;
+		}
+	}
+	int8_t offset = (int8_t)(median ^ 0x80);
+	if (offset == 0) return 0;
+
+	// subtract the common offset from all sensors (saturated)
+	for (uint8_t i = 0; i < count; i++) {
+		int16_t delta = (int16_t)deltas[i] - offset;
+		deltas[i] = delta > 127 ? 127 : (delta < -128 ? -128 : (int8_t)delta);
+	}
+	return offset;
+}
+
+// one pair of neighbors with its coupling factors, a list of them in the main program
+struct DigitalTouchNeighbor {
+	uint8_t a;           // first sensor (index in the delta array)
+	uint8_t b;           // second sensor
+	uint16_t couplingAB; // delta of b per delta of the touched a, in 1/65536, start with 0
+	uint16_t couplingBA; // delta of a per delta of the touched b, in 1/65536, start with 0
+};
+
+// function digitalTouchCrosstalkLearn
+// learns the coupling factors of "pairs" neighbors while single keys are touched, call it once
+// per scan: the sensor with the highest delta (above "threshold", only one with this delta) is
+// the touched key, every pair with this sensor moves the factor from this sensor to the other
+// one 1/4 towards the measured relation (rounded, so it reaches the relation), a touch of a few
+// scans is enough
+void digitalTouchCrosstalkLearn(const int8_t *deltas, uint8_t count, DigitalTouchNeighbor *neighbors, uint8_t pairs, int8_t threshold)
+{
+	// touched key
+	uint8_t key = 0;
+	bool unique = true;
+	for (uint8_t i = 1; i < count; i++) {
+		if (deltas[i] > deltas[key]) {
+			key = i;
+			unique = true;
+		} else if (deltas[i] == deltas[key]) {
+			unique = false;
+		}
+	}
+	int8_t delta = deltas[key];
+	if (delta <= threshold || !unique) return;
+
+	for (uint8_t p = 0; p < pairs; p++) {
+		DigitalTouchNeighbor *pair = &neighbors[p];
+		if (pair->a >= count || pair->b >= count) continue;
+		if (pair->a != key && pair->b != key) continue;
+		int8_t neighbor = deltas[pair->a == key ? pair->b : pair->a];
+		uint16_t *coupling = pair->a == key ? &pair->couplingAB : &pair->couplingBA;
+		uint32_t factor = neighbor > 0 ? ((uint32_t)neighbor << 16) / (uint32_t)delta : 0;
+		if (factor > 0xFFFF) factor = 0xFFFF;
+		int32_t difference = (int32_t)factor - (int32_t)*coupling;
+		*coupling = (uint16_t)((int32_t)*coupling + ((difference + 2) >> 2));
+	}
+}
+
+// function digitalTouchCrosstalk
+// writes the "deltas" without the expected crosstalk to "corrected" (another array with "count"
+// bytes), call it once per scan with the list of "pairs" neighbors
+// only positive deltas (touches) couple to the neighbors, the correction uses the deltas before
+// the correction, so the order of the pairs does not matter
+void digitalTouchCrosstalk(int8_t *corrected, const int8_t *deltas, uint8_t count, const DigitalTouchNeighbor *neighbors, uint8_t pairs)
+{
+	for (uint8_t i = 0; i < count; i++) corrected[i] = deltas[i];
+	for (uint8_t p = 0; p < pairs; p++) {
+		const DigitalTouchNeighbor *pair = &neighbors[p];
+		if (pair->a >= count || pair->b >= count) continue;
+		int8_t a = deltas[pair->a];
+		int8_t b = deltas[pair->b];
+		if (a > 0) {
+			int16_t value = (int16_t)corrected[pair->b] - (int16_t)(((uint32_t)a * pair->couplingAB + 0x8000) >> 16);
+			corrected[pair->b] = value < -128 ? -128 : (int8_t)value;
+		}
+		if (b > 0) {
+			int16_t value = (int16_t)corrected[pair->a] - (int16_t)(((uint32_t)b * pair->couplingBA + 0x8000) >> 16);
+			corrected[pair->a] = value < -128 ? -128 : (int8_t)value;
+		}
+	}
+}
@@ -0,0 +1,201 @@
+/*
+DigitalTouchTelemetry.h - Compressed telemetry of sensor values for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+Printing the values of 16 sensors as decimal text takes about 64 characters per scan, so a serial
+link at 115200 baud carries about 180 scans per second. Most values do not change from one scan
+to the next, so the telemetry only sends the changes: every changed sensor as the difference to
+the last frame (zigzag varint, 1 byte for a change of -64..63), and a bit mask of the changed
+sensors. Every "interval" frames a keyframe with all values allows the receiver to start and
+to recover after a lost frame. A scan without changes takes 7 bytes for 16 sensors (sync, sequence,
+count, length, 2 bytes mask, checksum).
+
+Frame:
+	0xD7                 sync
+	bit 7 keyframe, bits 6..0 sequence number
+	count                number of sensors
+	length               number of payload bytes
+	payload              keyframe: all values as varint
+	                     other frames: (count + 7) / 8 bytes mask (bit i = sensor i, LSB first),
+	                     then the zigzag varint differences of the sensors in the mask
+	checksum             sum of all bytes from the sequence number to the end of the payload
+
+Varint: 7 bits per byte, LSB first, bit 7 set if another byte follows.
+Zigzag: 0, -1, 1, -2, 2, ... is coded as 0, 1, 2, 3, 4, ...
+
+The encoder writes a frame into a buffer, send it with Serial.write(frame, length). The decoder
+is in the same file and is used by extras/linux/touchtelemetry. Both use no dynamic memory and run
+on the controller and on Linux. A frame must fit into 255 bytes (the length of the encoder is
+8 bit), in the worst case every value takes 2 bytes, so up to DIGITALTOUCH_TELEMETRY_MAX = 117
+sensors are possible (DIGITALTOUCH_TELEMETRY_SIZE(117) = 254 bytes).
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+
+// first byte of a frame
+#define DIGITALTOUCH_TELEMETRY_SYNC 0xD7
+
+// maximum size of a frame for "count" sensors
+#define DIGITALTOUCH_TELEMETRY_SIZE(count) (5 + ((count) + 7) / 8 + 2 * (count))
+
+// maximum number of sensors, the largest frame must fit into 255 bytes
+#define DIGITALTOUCH_TELEMETRY_MAX 117
+
+// state of the encoder in the main program, start with { previous, count, interval }
+struct DigitalTouchTelemetry {
+	uint8_t *previous; // "count" values of the last frame
+	uint8_t count;
+	uint8_t interval;  // frames from one keyframe to the next
+	uint8_t frames;    // frames since the last keyframe, 0 = the next frame is a keyframe
+	uint8_t sequence;
+};
+
+// function digitalTouchVarint
+// writes a varint at "buffer", returns the number of bytes
+uint8_t digitalTouchVarint(uint8_t *buffer, uint16_t value)
+{
+	uint8_t length = 0;
+	while (value >= 0x80) {
+		buffer[length++] = (uint8_t)value | 0x80;
+		value >>= 7;
+	}
+	buffer[length++] = (uint8_t)value;
+	return length;
+}
+
+// function digitalTouchTelemetryEncode
+// encodes the "values" of a scan into "frame" (DIGITALTOUCH_TELEMETRY_SIZE(count) bytes)
+// returns the length of the frame, 0 (no frame) if count is more than DIGITALTOUCH_TELEMETRY_MAX
+uint8_t digitalTouchTelemetryEncode(DigitalTouchTelemetry *telemetry, const uint8_t *values, uint8_t *frame)
+{
+	bool keyframe = telemetry->frames == 0;
+	uint8_t count = telemetry->count;
+	uint8_t length = 4;
+	if (count > DIGITALTOUCH_TELEMETRY_MAX) return 0;
+
+	if (keyframe) {
+		for (uint8_t i = 0; i < count; i++) length += digitalTouchVarint(&frame[length], values[i]);
+	} else {
+		// mask of the changed sensors, then their differences
+		uint8_t maskBytes = (count + 7) / 8;
+		for (uint8_t i = 0; i < maskBytes; i++) frame[length + i] = 0;
+		uint8_t *mask = &frame[length];
+		length += maskBytes;
+		for (uint8_t i = 0; i < count; i++) {
+			int16_t difference = (int16_t)values[i] - telemetry->previous[i];
+			if (difference == 0) continue;
+			mask[i >> 3] |= 1 << (i & 7);
+			uint16_t zigzag = ((uint16_t)difference << 1) ^ (uint16_t)(difference >> 15);
+			length += digitalTouchVarint(&frame[length], zigzag);
+		}
+	}
+	for (uint8_t i = 0; i < count; i++) telemetry->previous[i] = values[i];
+
+	// header and checksum
+	frame[0] = DIGITALTOUCH_TELEMETRY_SYNC;
+	frame[1] = (keyframe ? 0x80 : 0) | (telemetry->sequence & 0x7F);
+	frame[2] = count;
+	frame[3] = length - 4;
+	uint8_t checksum = 0;
+	for (uint8_t i = 1; i < length; i++) checksum += frame[i];
+	frame[length++] = checksum;
+
+	telemetry->sequence++;
+	if (++telemetry->frames >= telemetry->interval) telemetry->frames = 0;
+	return length;
+}
+
+// state of the decoder, start with { values, count, frame } and all other members zero
+// "frame" has DIGITALTOUCH_TELEMETRY_SIZE(count) bytes
+struct DigitalTouchTelemetryDecoder {
+	uint8_t *values;  // "count" values, valid after the first keyframe
+	uint8_t count;
+	uint8_t *frame;   // buffer for the received frame
+	uint8_t position; // received bytes of the frame, 0 = waiting for the sync byte
+	bool valid;       // values are valid (a keyframe was received and no frame was lost since)
+	uint8_t sequence; // expected sequence number
+	uint16_t errors;  // frames with wrong checksum or lost frames
+};
+
+// function digitalTouchTelemetryApply
+// applies the payload of a complete frame to the values, returns false if it is not valid
+bool digitalTouchTelemetryApply(DigitalTouchTelemetryDecoder *decoder, bool keyframe, const uint8_t *payload, uint8_t length)
+{
+	uint8_t count = decoder->count;
+	uint8_t maskBytes = keyframe ? 0 : (count + 7) / 8;
+	if (length < maskBytes) return false;
+	uint8_t position = maskBytes;
+
+	for (uint8_t i = 0; i < count; i++) {
+		if (!keyframe && !(payload[i >> 3] & (1 << (i & 7)))) continue;
+
+		// varint
+		uint16_t value = 0;
+		uint8_t shift = 0;
+		uint8_t byte;
+		do {
+			if (position >= length || shift > 14) return false;
+			byte = payload[position++];
+			value |= (uint16_t)(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		if (keyframe) {
+			decoder->values[i] = (uint8_t)value;
+		} else {
+			int16_t difference = (int16_t)(value >> 1) ^ -(int16_t)(value & 1);
+			decoder->values[i] = (uint8_t)(decoder->values[i] + difference);
+		}
+	}
+	return position == length;
+}
+
+// function digitalTouchTelemetryDecode
+// takes the next received byte, returns true when a frame was decoded and "values" are updated
+// Frames after a lost or damaged frame are ignored until the next keyframe.
+bool digitalTouchTelemetryDecode(DigitalTouchTelemetryDecoder *decoder, uint8_t byte)
+{
+	uint8_t *frame = decoder->frame;
+	if (decoder->position == 0 && byte != DIGITALTOUCH_TELEMETRY_SYNC) return false;
+	frame[decoder->position++] = byte;
+
+	// header complete: check count and length
+	if (decoder->position == 4) {
+		if (frame[2] != decoder->count || frame[3] > DIGITALTOUCH_TELEMETRY_SIZE(decoder->count) - 5) {
+			decoder->position = 0;
+			decoder->errors++;
+			return false;
+		}
+	}
+	if (decoder->position < 5 || decoder->position < frame[3] + 5) return false;
+	decoder->position = 0;
+
+	// checksum
+	uint8_t length = frame[3];
+	uint8_t checksum = 0;
+	for (uint8_t i = 1; i < length + 4; i++) checksum += frame[i];
+	if (checksum != frame[length + 4]) {
+		decoder->errors++;
+		decoder->valid = false;
+		return false;
+	}
+
+	// a lost frame makes the values invalid until the next keyframe
+	bool keyframe = frame[1] & 0x80;
+	uint8_t sequence = frame[1] & 0x7F;
+	if (!keyframe && sequence != decoder->sequence) {
+		if (decoder->valid) decoder->errors++;
+		decoder->valid = false;
+	}
+	decoder->sequence = (sequence + 1) & 0x7F;
+	if (!keyframe && !decoder->valid) return false;
+
+	decoder->valid = digitalTouchTelemetryApply(decoder, keyframe, &frame[4], length);
+	if (!decoder->valid) decoder->errors++;
+	return decoder->valid;
+}
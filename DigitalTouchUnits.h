@@ -0,0 +1,115 @@
+/*
+DigitalTouchUnits.h - Counts in capacitance for the DigitalTouch library
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+The result of digitalTouchRead() is the charging time of the sensor in loop counts:
+counts = Rp * C * ln(1 / (1 - Vth / Vdd)) * F_CPU / cycles per count. The same pad gives twice
+the counts at 16MHz as at 8MHz, so thresholds in counts only fit one board. The functions below
+convert between counts and capacitance at compile time (constexpr), so thresholds can be written
+in capacitance and one set of thresholds fits all clock speeds and resistors:
+
+	#define DIGITALTOUCH_RP 1000000
+	#define DIGITALTOUCH_PAD_FF 30000  // largest expected capacitance (pad and finger), checked
+	#include <DigitalTouchUnits.h>
+	#define sensorThreshold digitalTouchCounts(1500, DIGITALTOUCH_FF_PER_COUNT) // 1.5pF
+
+Capacitances are in fF (pF with three decimals) as integers. The cycles per count depend on the
+measuring loop (kernel) of the sensor, the constants DIGITALTOUCH_CYCLES_* below are counted from
+the instructions of the loops on AVR and can change with the compiler, measure them for exact
+results, e.g. with extras/simavr/touchsim (cycles of the measuring window divided by the counts).
+DIGITALTOUCH_FF_PER_COUNT is for the kernel DIGITALTOUCH_CYCLES (default: hard-coded functions),
+sensors with another kernel use DIGITALTOUCH_FF_PER_COUNT_OF(cycles), e.g. on the same board:
+
+	#define keyThreshold  digitalTouchCounts(1500, DIGITALTOUCH_FF_PER_COUNT_OF(DIGITALTOUCH_CYCLES_HARDCODED))
+	#define gridThreshold digitalTouchCounts(1500, DIGITALTOUCH_FF_PER_COUNT_OF(DIGITALTOUCH_CYCLES_PORT))
+
+The defaults are Rp = 1MOhm and the input HIGH at 60% of Vdd (ln factor 0.916).
+Sensors charged through the internal pull-up (sensorx_pullup) are outside of this model: the
+pull-up has 20..50kOhm depending on the chip and temperature, and the unrolled kernel counts 2
+cycles per count up to 16 and about 5 cycles above (see digitalTouchUnrolled in DigitalTouch.h).
+The QTouchADC and comparator methods (sensorx_adc, sensorx_acomp) do not measure a charging time
+through Rp either.
+
+The counter of digitalTouchRead() is 8 bit and gives 0 after 255 counts. With DIGITALTOUCH_PAD_FF
+a static_assert stops the compilation if this capacitance does not fit into the counter, e.g.
+when the clock is increased or Rp is changed.
+
+The functions need C++11 (Arduino IDE 1.6.6 and newer).
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+
+// CPU cycles per count of the measuring loops of DigitalTouch.h on AVR
+#define DIGITALTOUCH_CYCLES_HARDCODED 5  // digitalTouchRead_x(), sensorx_read: sbic, rjmp, inc, brne
+#define DIGITALTOUCH_CYCLES_GENERIC   7  // digitalTouchRead() through a pointer: ld, and, breq, inc, brne
+#define DIGITALTOUCH_CYCLES_PORT      10 // digitalTouchReadPort(): ld, and, brne, tst, breq, inc, cpi, brne
+
+// ln(1 / (1 - Vth / Vdd)) in 1/1000 for the input thresholds 50%, 60% (ATmega VIH) and 70%
+#define DIGITALTOUCH_LN_50 693
+#define DIGITALTOUCH_LN_60 916
+#define DIGITALTOUCH_LN_70 1204
+
+// function digitalTouchFemtofaradPerCount
+// capacitance of one count in fF with the CPU clock "fcpu" in Hz, "cycles" per count of the
+// measuring loop, "rp" in Ohm and the ln factor "ln" in 1/1000
+constexpr uint32_t digitalTouchFemtofaradPerCount(uint32_t fcpu, uint8_t cycles, uint32_t rp, uint16_t ln)
+{
+	// time of one count in ps, C = t / (Rp * ln), rounded
+	return (uint32_t)(((uint64_t)cycles * 1000000000000ULL / fcpu * 1000000ULL + (uint64_t)rp * ln / 2) / ((uint64_t)rp * ln));
+}
+
+// function digitalTouchCapacitance
+// capacitance in fF of "counts"
+constexpr uint32_t digitalTouchCapacitance(uint8_t counts, uint32_t femtofaradPerCount)
+{
+	return (uint32_t)counts * femtofaradPerCount;
+}
+
+// function digitalTouchCountLimit
+// counts limited to 1..255
+constexpr uint8_t digitalTouchCountLimit(uint32_t counts)
+{
+	return counts > 255 ? 255 : (counts < 1 ? 1 : (uint8_t)counts);
+}
+
+// function digitalTouchCounts
+// counts of the capacitance "femtofarad" (rounded, 1..255), e.g. for thresholds
+constexpr uint8_t digitalTouchCounts(uint32_t femtofarad, uint32_t femtofaradPerCount)
+{
+	return digitalTouchCountLimit((femtofarad + femtofaradPerCount / 2) / femtofaradPerCount);
+}
+
+// function digitalTouchFits
+// true if the capacitance "femtofarad" is measured without overflow of the 8 bit counter
+constexpr bool digitalTouchFits(uint32_t femtofarad, uint32_t femtofaradPerCount)
+{
+	return femtofarad / femtofaradPerCount < 255;
+}
+
+// board parameters, define them before the include
+#ifndef DIGITALTOUCH_RP
+	#define DIGITALTOUCH_RP 1000000
+#endif
+#ifndef DIGITALTOUCH_CYCLES
+	#define DIGITALTOUCH_CYCLES DIGITALTOUCH_CYCLES_HARDCODED
+#endif
+#ifndef DIGITALTOUCH_LN
+	#define DIGITALTOUCH_LN DIGITALTOUCH_LN_60
+#endif
+
+#ifdef F_CPU
+	// capacitance of one count of this board, for a kernel with "cycles" per count and the default kernel
+	#define DIGITALTOUCH_FF_PER_COUNT_OF(cycles) digitalTouchFemtofaradPerCount(F_CPU, cycles, DIGITALTOUCH_RP, DIGITALTOUCH_LN)
+	#define DIGITALTOUCH_FF_PER_COUNT DIGITALTOUCH_FF_PER_COUNT_OF(DIGITALTOUCH_CYCLES)
+	static_assert(DIGITALTOUCH_FF_PER_COUNT > 0, "DigitalTouchUnits: one count is less than 1fF, use a larger DIGITALTOUCH_CYCLES or a smaller DIGITALTOUCH_RP");
+
+	#ifdef DIGITALTOUCH_PAD_FF
+		static_assert(digitalTouchFits(DIGITALTOUCH_PAD_FF, DIGITALTOUCH_FF_PER_COUNT),
+			"DigitalTouchUnits: DIGITALTOUCH_PAD_FF overflows the counter of digitalTouchRead(), use a smaller DIGITALTOUCH_RP or a slower clock");
+	#endif
+#endif
@@ -47,8 +47,25 @@ digitalRead() is not used, but the register and bitmask must be stored in variab
 
 Make sure, that you do not define a sensor that is not used.
 
-Defining sensorx_input, sensorx_output, sensorx_high, sensorx_low is very similar. Sometimes the binary
-value has to be inverted. Just refer to the following examples:
+Defining sensorx_input, sensorx_output, sensorx_high, sensorx_low is very similar, but here only one
+bit of the port is changed. Use the macros digitalTouchSetBit(register, bit) and
+digitalTouchClearBit(register, bit) of the library for this. A definition like
+PORTB = PORTB & B11111110 would also work, but it is a read-modify-write sequence that can be
+corrupted by an interrupt routine using another pin of the same port. The library macros compile
+to a single sbi/cbi instruction (or a short critical section on ports that do not allow this).
+Just refer to the following examples:
+
+If a sensor has no external resistor Rp, add "#define sensorx_pullup" (without value). The sensor is
+then charged through the internal pull-up of the pin, see the comments in DigitalTouch.h about the
+lower resolution. sensorx_high and sensorx_low are used to switch the pull-up on and off. The
+pull-up only works with the hard-coded functions (at least sensorx_read, sensorx_input, sensorx_high).
+
+If a sensor is connected to an ADC pin, you can also use the QTouchADC method (like the AnalogTouch
+library) for it by adding "#define sensorx_adc 3" with the ADC channel number of the pin (here 3).
+Rp is not required then. Do not define sensorx_read for this sensor, all other definitions are
+not used by this method.
+The same way "#define sensorx_acomp 3" selects the analog comparator method (stable threshold,
+timer input capture), see DigitalTouch.h.
 
 */
 
@@ -57,19 +74,20 @@ value has to be inverted. Just refer to the following examples:
 // Arduino Mega: Pin 53 = Port PB0
 #define sensor1   53                                 // Arduino pin number
 //#define sensor1_read   (PINB & B00000001)            // replacing digitalRead(sensor1)
-//#define sensor1_input  DDRB = DDRB & B11111110       // replacing pinMode(sensor1, INPUT)
-//#define sensor1_output DDRB = DDRB | B00000001       // replacing pinMode(sensor1, OUTPUT)
-//#define sensor1_low    PORTB = PORTB & B11111110     // replacing digitalWrite(sensor1, LOW)
-//#define sensor1_high   PORTB = PORTB | B00000001     // replacing digitalWrite(sensor1, HIGH)
+//#define sensor1_input  digitalTouchClearBit(DDRB, 0)  // replacing pinMode(sensor1, INPUT)
+//#define sensor1_output digitalTouchSetBit(DDRB, 0)    // replacing pinMode(sensor1, OUTPUT)
+//#define sensor1_low    digitalTouchClearBit(PORTB, 0) // replacing digitalWrite(sensor1, LOW)
+//#define sensor1_high   digitalTouchSetBit(PORTB, 0)   // replacing digitalWrite(sensor1, HIGH)
+//#define sensor1_pullup                                // no Rp, charge through internal pull-up
 
 //
 // Arduino Mega: Pin 51 = Port PB2
 #define sensor2   51
 //#define sensor2_read   (PINB & B00000100)
-//#define sensor2_input  DDRB = DDRB & B11111011
-//#define sensor2_output DDRB = DDRB | B00000100
-//#define sensor2_low    PORTB = PORTB & B11111011
-//#define sensor2_high   PORTB = PORTB | B00000100
+//#define sensor2_input  digitalTouchClearBit(DDRB, 2)
+//#define sensor2_output digitalTouchSetBit(DDRB, 2)
+//#define sensor2_low    digitalTouchClearBit(PORTB, 2)
+//#define sensor2_high   digitalTouchSetBit(PORTB, 2)
 
 // DigitalTouch library
 #include <DigitalTouch.h>
@@ -110,8 +128,10 @@ void loop()
   uint8_t value2 = digitalTouchMedian(sensor2);
 
   // capture all sensors
-  bool touched1 = (value1 - (uint8_t)(ref1 >> offset)) > sensorThreshold;
-  bool touched2 = (value2 - (uint8_t)(ref2 >> offset)) > sensorThreshold;
+  int16_t delta1 = digitalTouchDelta(value1, ref1, offset);
+  int16_t delta2 = digitalTouchDelta(value2, ref2, offset);
+  bool touched1 = delta1 > sensorThreshold;
+  bool touched2 = delta2 > sensorThreshold;
 
   // LEDs on when touched (LEDs can be used for everything, not limited to sensor results)
   // you can remove the ifdef/else and just write the version that you want to use
@@ -131,7 +151,7 @@ void loop()
   Serial.print("\t");
 
   // Print calibrated value
-  Serial.print(value1 - (uint8_t)(ref1 >> offset));
+  Serial.print(delta1);
   Serial.print("\t");
 
   // Print raw value
@@ -150,7 +170,7 @@ void loop()
   Serial.print("\t");
 
   // Print calibrated value
-  Serial.print(value2 - (uint8_t)(ref2 >> offset));
+  Serial.print(delta2);
   Serial.print("\t");
 
   // Print raw value
@@ -162,16 +182,9 @@ void loop()
   Serial.print("\t");
   Serial.println(ref2);
 
-  // Self calibrate
-  if (value1 <= (uint8_t)(ref1 >> offset))
-    ref1 = ((uint16_t)value1 << offset);
-  // Cool down
-  else ref1++;
-
-  if (value2 <= (uint8_t)(ref2 >> offset))
-    ref2 = ((uint16_t)value2 << offset);
-  // Cool down
-  else ref2++;
+  // Self calibrate and cool down
+  ref1 = digitalTouchCalibrate(ref1, value1, offset);
+  ref2 = digitalTouchCalibrate(ref2, value2, offset);
 
   // Wait some time
   delay(100);
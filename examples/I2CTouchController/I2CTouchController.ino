@@ -0,0 +1,99 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch I2C touch controller example
+
+An ATTINY85 works as touch controller chip with two sensors. The host controller reads the
+touch state over I2C when the change interrupt line goes LOW. The register map is described
+in the library file DigitalTouchI2C.h.
+
+Pins (ATTINY85, Arduino pin number = port bit):
+PB0 SDA, PB2 SCL (USI)
+PB1 sensor 1, PB3 sensor 2 (Rp 1MOhm to Vdd each)
+PB4 change interrupt to the host, active low (open drain, pull-up at the host)
+
+The host can change the threshold, the number of samples and the number of confirmation scans
+by writing the CONFIG registers 0x10..0x12.
+
+for more comments see the example DigitalTouch and the documentation in the library files
+*/
+
+// sensors, see example DigitalTouch
+#define sensor1        1
+#define sensor1_read   (PINB & B00000010)
+#define sensor1_input  digitalTouchClearBit(DDRB, 1)
+#define sensor1_output digitalTouchSetBit(DDRB, 1)
+#define sensor1_low    digitalTouchClearBit(PORTB, 1)
+#define sensor1_high   digitalTouchSetBit(PORTB, 1)
+
+#define sensor2        3
+#define sensor2_read   (PINB & B00001000)
+#define sensor2_input  digitalTouchClearBit(DDRB, 3)
+#define sensor2_output digitalTouchSetBit(DDRB, 3)
+#define sensor2_low    digitalTouchClearBit(PORTB, 3)
+#define sensor2_high   digitalTouchSetBit(PORTB, 3)
+
+// change interrupt line, PORTB4 stays LOW, only the direction is switched (open drain)
+#define changeIrq_assert  digitalTouchSetBit(DDRB, 4)
+#define changeIrq_release digitalTouchClearBit(DDRB, 4)
+
+// DigitalTouch library
+#include <DigitalTouch.h>
+#include <DigitalTouchEvents.h>
+#include <DigitalTouchI2C.h>
+
+// 7 bit I2C address
+#define i2cAddress 0x38
+
+// level of filtering for self calibration
+#define offset 4
+
+// number of sensors
+#define sensorCount 2
+
+// configuration, can be changed by the host (CONFIG registers)
+#define configThreshold 0 // number of additional timing loops over baseline that indicate a touched sensor
+#define configSamples   1 // number of samples averaged for each measurement
+#define configConfirm   2 // number of scans that confirm a press or release
+uint8_t config[3] = { 4, 5, 2 };
+
+// results of the scan, the registers read directly from these arrays
+const uint8_t pins[sensorCount] = { sensor1, sensor2 };
+uint8_t values[sensorCount];
+uint16_t refs[sensorCount] = { 0xFFFF, 0xFFFF };
+int8_t deltas[sensorCount];
+uint8_t states[sensorCount];
+
+DigitalTouchI2CMap registers = { deltas, config, sensorCount, sizeof(config) };
+
+void setup()
+{
+  digitalTouchI2CBegin(&registers, i2cAddress);
+}
+
+void loop()
+{
+  // a new configuration from the host, 0 samples are not possible
+  if (digitalTouchI2CConfigChanged(&registers) && config[configSamples] == 0) config[configSamples] = 1;
+
+  // read all sensors, 255 is an overflow (no Rp, short circuit, ...)
+  bool overflow = false;
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    values[i] = digitalTouchAverage(pins[i], config[configSamples]);
+    if (values[i] == 255) overflow = true;
+  }
+  digitalTouchDeltas(deltas, values, refs, sensorCount, offset);
+
+  // touch state of all sensors
+  uint16_t touched = 0;
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    digitalTouchEvent(&states[i], deltas[i], config[configThreshold], config[configConfirm]);
+    if (states[i] & DIGITALTOUCH_TOUCHED) touched |= 1 << i;
+  }
+
+  // registers and change interrupt
+  digitalTouchI2CUpdate(&registers, touched, overflow);
+
+  // Self calibrate and cool down
+  for (uint8_t i = 0; i < sensorCount; i++) refs[i] = digitalTouchCalibrate(refs[i], values[i], offset);
+}
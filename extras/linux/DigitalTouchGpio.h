@@ -0,0 +1,194 @@
+/*
+DigitalTouchGpio.h - DigitalTouch measurement on Linux single-board computers
+
+Copyright (c) 2019 Rainer Urlacher
+published under the MIT License, see github repository
+
+This file replaces the AVR port access of DigitalTouch.h by the Linux GPIO character device
+(/dev/gpiochipN, uAPI v2, kernel 5.10 or newer). Include this file instead of DigitalTouch.h,
+all other functions of the library (digitalTouchAverage, digitalTouchMedian, digitalTouchDelta,
+digitalTouchCalibrate, ...) are the same as on the controller.
+
+Measurement:
+
+The sensor is wired as on the controller (Rp to Vdd, optional Rs and LED). The line is driven LOW
+to discharge the sensor. Then the line is switched to input with rising edge detection in one
+ioctl call. The kernel stores a timestamp for the edge, so the charging time does not depend on
+a busy loop or on the scheduler. The start time is taken directly before the ioctl, its latency
+is (almost) constant and ends up in the baseline.
+The resolution is much lower than on a controller: use Rp = 10MOhm, so the charging time is in
+the range of 100us. One count is DIGITALTOUCH_GPIO_NS_PER_COUNT nanoseconds (default 1us).
+If no edge arrives within 255 counts, the result is 255 (same as the overflow on the controller).
+
+Pins:
+
+The "pin" numbers of the library are indices into a table of lines, registered once with
+digitalTouchGpioBegin(pin, chip, offset). Up to DIGITALTOUCH_GPIO_PINS lines can be registered.
+
+Testing without hardware:
+
+The gpio-sim kernel module creates simulated chips, the input level of a line is set through
+its "pull" attribute in sysfs. See README.md in this folder.
+*/
+
+// Include guard
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <thread>
+#include <vector>
+
+// the generic function digitalTouchRead() of DigitalTouch.h calls digitalTouchReadGpio()
+#define DIGITALTOUCH_LINUX_GPIO
+
+// number of lines that can be registered
+#ifndef DIGITALTOUCH_GPIO_PINS
+	#define DIGITALTOUCH_GPIO_PINS 64
+#endif
+
+// nanoseconds per count of the result
+#ifndef DIGITALTOUCH_GPIO_NS_PER_COUNT
+	#define DIGITALTOUCH_GPIO_NS_PER_COUNT 1000
+#endif
+
+// file descriptors of the line requests, index is the pin number of the library, -1 = not used
+// written only by digitalTouchGpioBegin/End, so the measurement itself is thread safe per pin
+static int digitalTouchGpioLines[DIGITALTOUCH_GPIO_PINS];
+static bool digitalTouchGpioInitialized = false;
+
+// function digitalTouchGpioConfig
+// switches the requested line to output LOW (discharge) or to input with rising edge detection
+static int digitalTouchGpioConfig(int fd, bool input)
+{
+	struct gpio_v2_line_config config;
+	memset(&config, 0, sizeof(config));
+	if (input) {
+		config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+	} else {
+		// output value LOW for the (only) line of the request
+		config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+		config.num_attrs = 1;
+		config.attrs[0].mask = 1;
+		config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+		config.attrs[0].attr.values = 0;
+	}
+	return ioctl(fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config);
+}
+
+// function digitalTouchGpioBegin
+// registers line "offset" of the GPIO chip device (e.g. "/dev/gpiochip0") as library pin "pin"
+// the line is requested as output LOW, so the sensor is discharged until the first measurement
+// returns 0 on success, otherwise -1 and errno is set
+int digitalTouchGpioBegin(uint8_t pin, const char *chip, uint32_t offset)
+{
+	if (!digitalTouchGpioInitialized) {
+		for (uint8_t i = 0; i < DIGITALTOUCH_GPIO_PINS; i++) digitalTouchGpioLines[i] = -1;
+		digitalTouchGpioInitialized = true;
+	}
+	if (pin >= DIGITALTOUCH_GPIO_PINS || digitalTouchGpioLines[pin] >= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	int chipFd = open(chip, O_RDWR | O_CLOEXEC);
+	if (chipFd < 0) return -1;
+
+	struct gpio_v2_line_request request;
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = offset;
+	request.num_lines = 1;
+	strncpy(request.consumer, "DigitalTouch", sizeof(request.consumer) - 1);
+	request.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+	request.config.num_attrs = 1;
+	request.config.attrs[0].mask = 1;
+	request.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+	request.config.attrs[0].attr.values = 0;
+	request.event_buffer_size = 16;
+
+	int result = ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &request);
+	int error = errno;
+	close(chipFd);
+	if (result < 0) {
+		errno = error;
+		return -1;
+	}
+
+	// events are read without blocking, waiting is done by poll()
+	fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) | O_NONBLOCK);
+	digitalTouchGpioLines[pin] = request.fd;
+	return 0;
+}
+
+// function digitalTouchGpioEnd
+// releases the line of the library pin "pin"
+void digitalTouchGpioEnd(uint8_t pin)
+{
+	if (pin >= DIGITALTOUCH_GPIO_PINS || !digitalTouchGpioInitialized || digitalTouchGpioLines[pin] < 0) return;
+	close(digitalTouchGpioLines[pin]);
+	digitalTouchGpioLines[pin] = -1;
+}
+
+// function digitalTouchReadGpio
+// takes one sample of measurement, called by digitalTouchRead()
+// same result as on the controller: counts until the input is HIGH, 255 on overflow
+uint8_t digitalTouchReadGpio(uint8_t pin)
+{
+	if (pin >= DIGITALTOUCH_GPIO_PINS || !digitalTouchGpioInitialized || digitalTouchGpioLines[pin] < 0) return 255;
+	int fd = digitalTouchGpioLines[pin];
+	struct gpio_v2_line_event event;
+
+	// remove old events (e.g. bouncing of the last measurement)
+	while (read(fd, &event, sizeof(event)) == (ssize_t)sizeof(event));
+
+	// start charging, edge detection is switched on in the same step
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (digitalTouchGpioConfig(fd, true) < 0) return 255;
+	uint64_t startNs = (uint64_t)start.tv_sec * 1000000000ULL + (uint64_t)start.tv_nsec;
+
+	// wait for the rising edge, the kernel timestamp (CLOCK_MONOTONIC) is the end of the charging time
+	uint8_t cycleCounter = 255;
+	const int timeoutMs = (int)((255ULL * DIGITALTOUCH_GPIO_NS_PER_COUNT) / 1000000ULL) + 1;
+	struct pollfd waitFd = { fd, POLLIN, 0 };
+	if (poll(&waitFd, 1, timeoutMs) > 0 && read(fd, &event, sizeof(event)) == (ssize_t)sizeof(event)) {
+		uint64_t time = event.timestamp_ns > startNs ? event.timestamp_ns - startNs : 0;
+		time /= DIGITALTOUCH_GPIO_NS_PER_COUNT;
+		cycleCounter = time > 254 ? 255 : (uint8_t)time;
+	}
+
+	// discharge sensor cap (or use line for LED)
+	digitalTouchGpioConfig(fd, false);
+	return cycleCounter;
+}
+
+// the filters and the calibration are the same as on the controller
+#include "../../DigitalTouch.h"
+
+// function digitalTouchGpioScan
+// measures "count" pins in parallel with "threads" worker threads, every pin is filtered with
+// digitalTouchAverage(pin, samples) and the result is stored in values[i] for pins[i]
+// Each thread measures a fixed subset of the pins one after the other, so the time of a scan is
+// divided by the number of threads. Neighboring sensors measured at the same time influence each
+// other a bit (same as crosstalk on the board), a stable assignment keeps this in the baseline.
+void digitalTouchGpioScan(const uint8_t *pins, uint8_t count, uint8_t *values, uint8_t samples, uint8_t threads)
+{
+	if (threads < 2 || count < 2) {
+		for (uint8_t i = 0; i < count; i++) values[i] = digitalTouchAverage(pins[i], samples);
+		return;
+	}
+	std::vector<std::thread> workers;
+	for (uint8_t t = 0; t < threads && t < count; t++) {
+		workers.emplace_back([=]() {
+			for (uint8_t i = t; i < count; i += threads) values[i] = digitalTouchAverage(pins[i], samples);
+		});
+	}
+	for (std::thread &worker : workers) worker.join();
+}
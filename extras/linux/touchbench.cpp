@@ -0,0 +1,212 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchbench
+
+Times the processing functions of the library (no measurement) on the host, so alternatives of
+an algorithm can be compared quickly before they are tried on the controller. Every function
+runs over generated scans of 1 to 255 sensors: baseline values with noise and touches of single
+sensors, like recorded values. The result is the time per scan and per sensor and the throughput
+in sensors per second. The numbers are only comparable with each other, a controller is about
+100 to 1000 times slower.
+
+usage: touchbench [-t ms] [-k function]
+  -t <ms>        minimum time per function and number of sensors (default 50)
+  -k <function>  only functions that contain this text, e.g. -k slider
+
+"average" is the arithmetic of digitalTouchAverage() with a histogram (sum, digitalTouchHistogram
+and the division) over 5 generated samples per sensor without a measurement, all other functions
+are measured directly. Combinations that do not exist are printed as skipped: the telemetry frame
+holds at most DIGITALTOUCH_TELEMETRY_MAX (117) sensors in 255 bytes, a slider needs at least 2
+sensors.
+
+for more comments see the documentation in the library files
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "DigitalTouchGpio.h"
+#include "../../DigitalTouchEvents.h"
+#include "../../DigitalTouchScan.h"
+#include "../../DigitalTouchTelemetry.h"
+
+// level of filtering for self calibration
+#define offset 4
+
+// number of additional counts over baseline that indicate a touched sensor
+#define sensorThreshold 4
+
+// number of generated scans, the functions run over them again and again
+#define scans 256
+
+// maximum number of sensors (count is 8 bit in the library)
+#define maxSensors 255
+
+// data of all scans of one number of sensors
+struct Data {
+	uint8_t count;
+	std::vector<uint8_t> values;  // scans * count
+	std::vector<int8_t> deltas;   // scans * count
+	std::vector<uint16_t> refs;   // count
+	std::vector<uint8_t> states;  // count
+	std::vector<DigitalTouchNeighbor> neighbors; // chain of the sensors, count - 1 pairs
+	std::vector<uint8_t> previous; // count
+	std::vector<uint8_t> bins;     // 16 * count
+};
+
+// function nextRandom
+// xorshift, the same data in every run
+static uint32_t nextRandom(void)
+{
+	static uint32_t state = 2463534242u;
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// function generate
+// scans with baseline 30..37, noise +-2 and touches of single sensors with +12
+static void generate(Data &data, uint8_t count)
+{
+	data.count = count;
+	data.values.resize(scans * count);
+	data.deltas.resize(scans * count);
+	data.refs.assign(count, 0xFFFF);
+	data.states.assign(count, 0);
+	data.neighbors.clear();
+	for (int i = 0; i + 1 < count; i++) {
+		DigitalTouchNeighbor pair = { (uint8_t)i, (uint8_t)(i + 1), 8192, 8192 };
+		data.neighbors.push_back(pair);
+	}
+	data.previous.assign(count, 0);
+	data.bins.assign(16 * count, 0);
+	int touched = -1;
+	for (int scan = 0; scan < scans; scan++) {
+		if (scan % 20 == 0) touched = (nextRandom() & 1) ? (int)(nextRandom() % count) : -1;
+		for (int i = 0; i < count; i++) {
+			int value = 30 + (i & 7) + (int)(nextRandom() % 5) - 2;
+			if (i == touched) value += 12;
+			data.values[scan * count + i] = (uint8_t)value;
+		}
+	}
+	// deltas with the self calibration of the library
+	std::vector<uint16_t> refs(count, 0xFFFF);
+	for (int scan = 0; scan < scans; scan++) {
+		digitalTouchDeltas(&data.deltas[scan * count], &data.values[scan * count], refs.data(), count, offset);
+		for (int i = 0; i < count; i++) refs[i] = digitalTouchCalibrate(refs[i], data.values[scan * count + i], offset);
+	}
+	data.refs = refs;
+}
+
+// processing functions, same order as their names in main()
+enum Function { MEDIAN3, AVERAGE, DELTAS, CALIBRATE, EVENT, SLIDER, COMMONMODE, CROSSTALK, HISTOGRAM, TELEMETRY };
+
+// result of a function, prevents that the compiler removes the calls
+static volatile uint32_t sink;
+
+// function runScan
+// one scan of a function
+static void runScan(Function function, Data &data, int scan)
+{
+	uint8_t count = data.count;
+	uint8_t *values = &data.values[scan * count];
+	int8_t *deltas = &data.deltas[scan * count];
+	uint32_t result = 0;
+
+	if (function == MEDIAN3) {
+		const uint8_t *next = &data.values[((scan + 1) % scans) * count];
+		const uint8_t *last = &data.values[((scan + 2) % scans) * count];
+		for (uint8_t i = 0; i < count; i++) result += digitalTouchMedian3(values[i], next[i], last[i]);
+	} else if (function == AVERAGE) {
+		// 5 samples of every sensor from the generated scans, as digitalTouchAverage() adds them
+		for (uint8_t i = 0; i < count; i++) {
+			uint16_t sum = 0;
+			for (int k = 0; k < 5; k++) {
+				uint8_t sample = data.values[((scan + k) % scans) * count + i];
+				sum += sample;
+				digitalTouchHistogram(&data.bins[16 * i], sample, (uint8_t)(data.refs[i] >> offset));
+			}
+			result += sum / 5;
+		}
+	} else if (function == DELTAS) {
+		int8_t out[maxSensors];
+		digitalTouchDeltas(out, values, data.refs.data(), count, offset);
+		result = (uint8_t)out[0];
+	} else if (function == CALIBRATE) {
+		for (uint8_t i = 0; i < count; i++) data.refs[i] = digitalTouchCalibrate(data.refs[i], values[i], offset);
+		result = data.refs[0];
+	} else if (function == EVENT) {
+		for (uint8_t i = 0; i < count; i++) result += digitalTouchEvent(&data.states[i], deltas[i], sensorThreshold, 2);
+	} else if (function == SLIDER) {
+		result = (uint32_t)digitalTouchSlider(deltas, count, sensorThreshold, false);
+	} else if (function == COMMONMODE) {
+		int8_t copy[maxSensors];
+		memcpy(copy, deltas, count);
+		result = (uint32_t)digitalTouchCommonMode(copy, count, NULL);
+	} else if (function == CROSSTALK) {
+		int8_t corrected[maxSensors];
+		digitalTouchCrosstalk(corrected, deltas, count, data.neighbors.data(), (uint8_t)data.neighbors.size());
+		result = (uint8_t)corrected[0];
+	} else if (function == HISTOGRAM) {
+		for (uint8_t i = 0; i < count; i++) digitalTouchHistogram(&data.bins[16 * i], values[i], (uint8_t)(data.refs[i] >> offset));
+		result = data.bins[8];
+	} else if (function == TELEMETRY) {
+		uint8_t frame[DIGITALTOUCH_TELEMETRY_SIZE(DIGITALTOUCH_TELEMETRY_MAX)];
+		DigitalTouchTelemetry telemetry = { data.previous.data(), count, 32, (uint8_t)(scan % 32 ? 1 : 0), 0 };
+		result = digitalTouchTelemetryEncode(&telemetry, values, frame);
+	}
+	sink = sink + result;
+}
+
+int main(int argc, char *argv[])
+{
+	long minimumMs = 50;
+	const char *filter = NULL;
+	int option;
+	while ((option = getopt(argc, argv, "t:k:")) != -1) {
+		if (option == 't') minimumMs = atol(optarg);
+		else if (option == 'k') filter = optarg;
+		else {
+			fprintf(stderr, "usage: %s [-t ms] [-k function]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	static const char *functions[] = { "median3", "average", "deltas", "calibrate", "event", "slider", "commonmode", "crosstalk", "histogram", "telemetry" };
+	static const uint8_t counts[] = { 1, 4, 16, 64, 255 };
+
+	printf("function      sensors   ns/scan  ns/sensor  Msensors/s\n");
+	for (int function = MEDIAN3; function <= TELEMETRY; function++) {
+		if (filter && !strstr(functions[function], filter)) continue;
+		for (uint8_t count : counts) {
+			// the telemetry frame must fit into 255 bytes, a slider needs 2 sensors
+			if ((function == TELEMETRY && count > DIGITALTOUCH_TELEMETRY_MAX) || (function == SLIDER && count < 2)) {
+				printf("%-12s  %7u  skipped\n", functions[function], count);
+				continue;
+			}
+			Data data;
+			generate(data, count);
+
+			// run until the minimum time is reached
+			typedef std::chrono::steady_clock Clock;
+			Clock::time_point start = Clock::now();
+			unsigned long runs = 0;
+			double elapsedNs;
+			do {
+				for (int scan = 0; scan < scans; scan++) runScan((Function)function, data, scan);
+				runs += scans;
+				elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+			} while (elapsedNs < minimumMs * 1e6);
+
+			double perScan = elapsedNs / runs;
+			double perSensor = perScan / count;
+			printf("%-12s  %7u  %8.1f  %9.2f  %10.1f\n", functions[function], count, perScan, perSensor, 1e3 / perSensor);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchenergy
+
+Estimates the charge per scan and the average current of a configuration from recorded values
+(e.g. of touchtelemetry or the example sketch), with the model of DigitalTouchEnergy.h. The
+measuring time of every sample follows from its value, the rest of the scan period is sleep.
+With -l every sensor has a LED that is on while the sensor is touched (like the example sketch).
+
+usage: touchenergy [options] < trace.txt
+  every line of the trace contains the values of all sensors of one scan (digitalTouchAverage)
+options:
+  -n <samples>   samples per measurement (default 5, one more is read and ignored)
+  -p <ms>        scan period (default 20)
+  -c <cycles>    CPU cycles per count of the measuring loop (default 7, generic path of
+                 digitalTouchRead as in the example sketch, 5 with the hard-coded IO functions)
+  -o <cycles>    CPU cycles per sample outside of the loop (default 40)
+  -l             LEDs on the sensor pins, on while touched
+  -m <MHz>       CPU clock (default 16)
+  -A <uA>        CPU active current (default 9000)
+  -S <uA>        CPU sleep current (default 5)
+  -P <uA>        current of one sensor pin LOW through Rp (default 5)
+  -L <uA>        current of one LED (default 3000)
+e.g. compare 5 and 10 samples: touchenergy -n 5 < trace.txt; touchenergy -n 10 < trace.txt
+
+for more comments see DigitalTouchEnergy.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "DigitalTouchGpio.h"
+#include "../../DigitalTouchEnergy.h"
+
+// level of filtering for self calibration
+#define offset 4
+
+// number of additional counts over baseline that indicate a touched sensor
+#define sensorThreshold 4
+
+// maximum number of sensors
+#define maxSensors DIGITALTOUCH_GPIO_PINS
+
+int main(int argc, char *argv[])
+{
+	uint8_t samples = 5;
+	uint32_t periodUS = 20000;
+	uint8_t cycles = DIGITALTOUCH_CYCLES_GENERIC;
+	uint32_t overhead = 40;
+	bool leds = false;
+	DigitalTouchBoard board = { 16, 9000, 5, 5, 3000 };
+	int option;
+	while ((option = getopt(argc, argv, "n:p:c:o:lm:A:S:P:L:")) != -1) {
+		if (option == 'n') samples = (uint8_t)atoi(optarg);
+		else if (option == 'p') periodUS = (uint32_t)atol(optarg) * 1000;
+		else if (option == 'c') cycles = (uint8_t)atoi(optarg);
+		else if (option == 'o') overhead = (uint32_t)atol(optarg);
+		else if (option == 'l') leds = true;
+		else if (option == 'm') board.mhz = (uint8_t)atoi(optarg);
+		else if (option == 'A') board.activeUA = (uint16_t)atoi(optarg);
+		else if (option == 'S') board.sleepUA = (uint16_t)atoi(optarg);
+		else if (option == 'P') board.pinUA = (uint16_t)atoi(optarg);
+		else if (option == 'L') board.ledUA = (uint16_t)atoi(optarg);
+		else return 1;
+	}
+	if (optind != argc || samples == 0 || board.mhz == 0 || periodUS == 0) {
+		fprintf(stderr, "usage: %s [-n samples] [-p ms] [-c cycles] [-o cycles] [-l] [-m MHz] [-A uA] [-S uA] [-P uA] [-L uA] < trace\n", argv[0]);
+		return 1;
+	}
+
+	uint16_t refs[maxSensors];
+	for (uint8_t i = 0; i < maxSensors; i++) refs[i] = 0xFFFF;
+	DigitalTouchEnergy energy = DigitalTouchEnergy();
+	uint32_t overruns = 0;
+	int count = -1;
+
+	char line[4 * maxSensors + 16];
+	while (fgets(line, sizeof(line), stdin)) {
+		// values of the scan, the first line gives the number of sensors
+		uint8_t values[maxSensors];
+		int found = 0;
+		char *position = line;
+		while (found < maxSensors) {
+			char *end;
+			unsigned long value = strtoul(position, &end, 10);
+			if (end == position) break;
+			values[found++] = value > 255 ? 255 : (uint8_t)value;
+			position = end;
+		}
+		if (found == 0) continue;
+		if (count < 0) count = found;
+		if (found != count) {
+			fprintf(stderr, "scan %u: %d values instead of %d\n", energy.scans + 1, found, count);
+			return 1;
+		}
+
+		// measuring time, touched sensors (LEDs on)
+		uint32_t activeCycles = 0;
+		uint8_t on = 0;
+		for (int i = 0; i < count; i++) {
+			activeCycles += (uint32_t)(samples + 1) * ((uint32_t)values[i] * cycles + overhead);
+			if (digitalTouchDelta(values[i], refs[i], offset) > sensorThreshold) on++;
+			refs[i] = digitalTouchCalibrate(refs[i], values[i], offset);
+		}
+		uint32_t activeUS = activeCycles / board.mhz;
+		if (activeUS > periodUS) overruns++;
+		digitalTouchEnergyScan(&energy, activeUS, periodUS, (uint8_t)(count - (leds ? on : 0)), leds ? on : 0);
+	}
+	if (energy.scans == 0) {
+		fprintf(stderr, "no scans\n");
+		return 1;
+	}
+
+	DigitalTouchEnergyTime charge = digitalTouchEnergyCharge(&energy, &board);
+	uint32_t current = digitalTouchEnergyCurrent(&energy, &board);
+	double total = (double)energy.activeUS * board.activeUA + (double)energy.sleepUS * board.sleepUA
+		+ (double)energy.pinUS * board.pinUA + (double)energy.ledUS * board.ledUA;
+	if (total == 0) total = 1;
+
+	printf("scans           %u (%d sensors, %u samples, period %u ms)\n", energy.scans, count, samples, periodUS / 1000);
+	printf("active per scan %llu us\n", (unsigned long long)(energy.activeUS / energy.scans));
+	printf("charge per scan %.1f nC\n", (double)charge / energy.scans);
+	printf("average current %u uA\n", current);
+	printf("  CPU active    %.1f %%\n", 100.0 * energy.activeUS * board.activeUA / total);
+	printf("  CPU sleep     %.1f %%\n", 100.0 * energy.sleepUS * board.sleepUA / total);
+	printf("  sensor pins   %.1f %%\n", 100.0 * energy.pinUS * board.pinUA / total);
+	printf("  LEDs          %.1f %%\n", 100.0 * energy.ledUS * board.ledUA / total);
+	if (overruns) printf("%u scans longer than the period\n", overruns);
+	return 0;
+}
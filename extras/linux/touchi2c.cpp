@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchi2c
+
+Checks the I2C slave of DigitalTouchI2C.h without hardware: a simulated bus master runs scripted
+transfers (write with register pointer, read with repeated start) through the byte handlers
+digitalTouchI2CReceive() and digitalTouchI2CTransmit(), the same ones the TWI/USI interrupt
+routines call on the controller. Every transfer is compared with the expected bytes, the register
+map and the change interrupt line are checked after it.
+
+usage: touchi2c [-v]
+  -v  print every transfer
+The exit status is 0 if all checks passed.
+
+for more comments see DigitalTouchI2C.h
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "DigitalTouchGpio.h"
+
+// change interrupt line of the simulation, true = asserted (LOW)
+static bool irqLine;
+#define changeIrq_assert  (irqLine = true)
+#define changeIrq_release (irqLine = false)
+#include "../../DigitalTouchI2C.h"
+
+static bool verbose;
+static unsigned failures;
+
+// function busWrite
+// one write transfer of the master: register pointer, then the data bytes
+static void busWrite(uint8_t reg, const std::vector<uint8_t> &data)
+{
+	digitalTouchI2CReceive(reg, true);
+	for (uint8_t byte : data) digitalTouchI2CReceive(byte, false);
+	if (verbose) {
+		printf("write %02X:", reg);
+		for (uint8_t byte : data) printf(" %02X", byte);
+		printf("\n");
+	}
+}
+
+// function busRead
+// write of the register pointer, repeated start and "length" bytes read
+static std::vector<uint8_t> busRead(uint8_t reg, uint8_t length)
+{
+	std::vector<uint8_t> data;
+	digitalTouchI2CReceive(reg, true);
+	for (uint8_t i = 0; i < length; i++) data.push_back(digitalTouchI2CTransmit());
+	if (verbose) {
+		printf("read  %02X:", reg);
+		for (uint8_t byte : data) printf(" %02X", byte);
+		printf("\n");
+	}
+	return data;
+}
+
+// function check
+// counts and prints a failed check
+static void check(bool ok, const char *what)
+{
+	if (ok) {
+		if (verbose) printf("  ok    %s\n", what);
+		return;
+	}
+	printf("  FAIL  %s\n", what);
+	failures++;
+}
+
+// function checkBytes
+// compares a transfer with the expected bytes
+static void checkBytes(const std::vector<uint8_t> &data, const std::vector<uint8_t> &expected, const char *what)
+{
+	check(data == expected, what);
+	if (data != expected) {
+		printf("        got");
+		for (uint8_t byte : data) printf(" %02X", byte);
+		printf(", expected");
+		for (uint8_t byte : expected) printf(" %02X", byte);
+		printf("\n");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int option;
+	while ((option = getopt(argc, argv, "v")) != -1) {
+		if (option == 'v') verbose = true;
+		else {
+			fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// register map of a controller with 3 sensors and 3 configuration bytes
+	int8_t deltas[3] = { 1, -2, 20 };
+	uint8_t config[3] = { 4, 5, 2 };
+	DigitalTouchI2CMap map = { deltas, config, 3, sizeof(config), 0, 0, 0, 0 };
+	digitalTouchI2CRegisters = &map;
+
+	// no bus activity before the first update
+	checkBytes(busRead(DIGITALTOUCH_REG_STATUS, 6), { 0x00, 0x00, 0x00, 0x00, 3, DIGITALTOUCH_VERSION },
+		"STATUS, TOUCHED, COUNT, VERSION in one block (auto increment)");
+	check(!irqLine, "IRQ line released at start");
+
+	// a touch sets the change flag and asserts the IRQ line
+	digitalTouchI2CUpdate(&map, 0x0104, false);
+	check(irqLine, "IRQ line asserted after a change");
+	checkBytes(busRead(DIGITALTOUCH_REG_STATUS, 2), { DIGITALTOUCH_STATUS_CHANGE, 0x00 }, "STATUS shows the change");
+	check(irqLine, "reading STATUS keeps the IRQ line");
+	checkBytes(busRead(DIGITALTOUCH_REG_TOUCHED, 2), { 0x04, 0x01 }, "TOUCHED LSB first");
+	check(!irqLine, "reading TOUCHED releases the IRQ line");
+	checkBytes(busRead(DIGITALTOUCH_REG_STATUS, 1), { 0x00 }, "reading TOUCHED clears the change flag");
+
+	// the same state again is no change
+	digitalTouchI2CUpdate(&map, 0x0104, false);
+	check(!irqLine, "no IRQ without a change");
+
+	// the upper byte is latched with the lower byte, a change in between does not tear the value
+	digitalTouchI2CUpdate(&map, 0x0201, false);
+	digitalTouchI2CReceive(DIGITALTOUCH_REG_TOUCHED, true);
+	uint8_t low = digitalTouchI2CTransmit();
+	digitalTouchI2CUpdate(&map, 0x0000, false);
+	uint8_t high = digitalTouchI2CTransmit();
+	check(low == 0x01 && high == 0x02, "TOUCHED upper byte latched with the lower byte");
+	check(irqLine, "change during the read asserts the IRQ line again");
+	busRead(DIGITALTOUCH_REG_TOUCHED, 2);
+
+	// overflow fault
+	digitalTouchI2CUpdate(&map, 0x0000, true);
+	checkBytes(busRead(DIGITALTOUCH_REG_STATUS, 1), { DIGITALTOUCH_STATUS_OVERFLOW }, "STATUS shows the overflow");
+	digitalTouchI2CUpdate(&map, 0x0000, false);
+	checkBytes(busRead(DIGITALTOUCH_REG_STATUS, 1), { 0x00 }, "overflow cleared by the next update");
+
+	// deltas read directly from the array of the main program, addresses after the end read as 0
+	checkBytes(busRead(DIGITALTOUCH_REG_DELTAS, 4), { 0x01, 0xFE, 0x14, 0x00 }, "DELTAS and 0 after the last sensor");
+	deltas[1] = 7;
+	checkBytes(busRead(DIGITALTOUCH_REG_DELTAS + 1, 1), { 0x07 }, "DELTAS follow the array");
+	checkBytes(busRead(0x08, 2), { 0x00, 0x00 }, "unused addresses read as 0");
+
+	// configuration write with auto increment
+	check(!digitalTouchI2CConfigChanged(&map), "no configuration change at start");
+	busWrite(DIGITALTOUCH_REG_CONFIG + 1, { 9, 3 });
+	check(config[0] == 4 && config[1] == 9 && config[2] == 3, "CONFIG written with auto increment");
+	check(digitalTouchI2CConfigChanged(&map), "configuration change reported");
+	check(!digitalTouchI2CConfigChanged(&map), "configuration change reported only once");
+	checkBytes(busRead(DIGITALTOUCH_REG_CONFIG, 4), { 4, 9, 3, 0 }, "CONFIG read back, 0 after the end");
+
+	// writes outside of CONFIG are ignored
+	busWrite(DIGITALTOUCH_REG_CONFIG + 2, { 8, 99, 99 });
+	check(config[2] == 8, "CONFIG write up to the last byte");
+	busWrite(DIGITALTOUCH_REG_STATUS, { 0xFF, 0xFF, 0xFF, 0xFF });
+	checkBytes(busRead(DIGITALTOUCH_REG_STATUS, 4), { DIGITALTOUCH_STATUS_CONFIG, 0x00, 0x00, 0x00 }, "STATUS and TOUCHED are read only");
+	busWrite(DIGITALTOUCH_REG_DELTAS, { 0x55 });
+	check(deltas[0] == 1, "DELTAS are read only");
+	digitalTouchI2CConfigChanged(&map);
+
+	// the register pointer wraps at 0xFF
+	checkBytes(busRead(0xFF, 2), { 0x00, 0x00 }, "register pointer wraps to STATUS");
+
+	// no register map: the handlers do nothing
+	digitalTouchI2CRegisters = 0;
+	digitalTouchI2CReceive(DIGITALTOUCH_REG_CONFIG, true);
+	digitalTouchI2CReceive(0x77, false);
+	check(digitalTouchI2CTransmit() == 0 && config[0] == 4, "no register map: reads 0, writes ignored");
+
+	if (failures) {
+		printf("%u checks failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
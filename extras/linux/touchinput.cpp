@@ -0,0 +1,334 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchinput
+
+Publishes touch sensors as a Linux input device through /dev/uinput, so every UI stack
+(X11, Wayland, console, evtest) can use them. Single sensors become keys, groups of sensors
+become a slider (ABS_X) or a wheel (ABS_WHEEL) with BTN_TOUCH while touched.
+
+All events of one scan are written at once, closed by one SYN_REPORT. The program waits in
+poll() for the scan timer (timerfd) or, in simulation mode, for the next line on stdin.
+No sleeps are used.
+
+usage: touchinput [options] <chip> <sensor> [<sensor> ...]
+  <chip>     GPIO chip device (e.g. /dev/gpiochip0), or "-" to read raw values from stdin
+  <sensor>   key:<line>:<key code>     e.g. key:17:28 (KEY_ENTER)
+             slider:<line>,<line>,...  e.g. slider:5,6,13,19
+             wheel:<line>,<line>,...   at most one slider and one wheel
+options:
+  -n <samples>   samples averaged per measurement (default 5)
+  -t <threads>   measuring threads (default 4)
+  -p <ms>        scan period in milliseconds (default 20)
+
+Simulation mode: every line on stdin contains the raw values of all sensors separated by
+spaces or tabs, in the order of the command line (slider and wheel sensors in their order).
+This allows testing on a desktop with recorded or generated values:
+  ./touchinput - key:0:30 key:1:48 < trace.txt
+
+for more comments see DigitalTouchGpio.h, DigitalTouchEvents.h and DigitalTouch.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <linux/uinput.h>
+#include <vector>
+#include "DigitalTouchGpio.h"
+#include "../../DigitalTouchEvents.h"
+
+// level of filtering for self calibration
+#define offset 4
+
+// number of additional counts over baseline that indicate a touched sensor
+#define sensorThreshold 4
+
+// scans in a row that confirm a press or release
+#define confirmScans 2
+
+// maximum number of sensors
+#define maxSensors DIGITALTOUCH_GPIO_PINS
+
+// kind of a sensor
+enum SensorKind { KEY, SLIDER, WHEEL };
+
+struct Sensor {
+	SensorKind kind;
+	uint32_t line;
+	uint16_t code;
+};
+
+static std::vector<Sensor> sensors;
+
+// function parseSensor
+// adds the sensors of one command line argument, returns false on a syntax error
+static bool parseSensor(const char *arg)
+{
+	SensorKind kind;
+	const char *list;
+	if (strncmp(arg, "key:", 4) == 0) {
+		char *end;
+		Sensor sensor = { KEY, (uint32_t)strtoul(arg + 4, &end, 0), 0 };
+		if (*end != ':') return false;
+		sensor.code = (uint16_t)strtoul(end + 1, NULL, 0);
+		sensors.push_back(sensor);
+		return true;
+	} else if (strncmp(arg, "slider:", 7) == 0) {
+		kind = SLIDER;
+		list = arg + 7;
+	} else if (strncmp(arg, "wheel:", 6) == 0) {
+		kind = WHEEL;
+		list = arg + 6;
+	} else return false;
+
+	for (const Sensor &sensor : sensors) if (sensor.kind == kind) return false;
+	while (*list) {
+		char *end;
+		Sensor sensor = { kind, (uint32_t)strtoul(list, &end, 0), 0 };
+		if (end == list) return false;
+		sensors.push_back(sensor);
+		list = (*end == ',') ? end + 1 : end;
+	}
+	return true;
+}
+
+// function createDevice
+// creates the uinput device with all keys and axes of the sensors, returns the file descriptor
+static int createDevice(bool slider, bool wheel)
+{
+	int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) return -1;
+
+	ioctl(fd, UI_SET_EVBIT, EV_KEY);
+	for (const Sensor &sensor : sensors) {
+		if (sensor.kind == KEY) ioctl(fd, UI_SET_KEYBIT, sensor.code);
+	}
+	if (slider || wheel) {
+		ioctl(fd, UI_SET_KEYBIT, BTN_TOUCH);
+		ioctl(fd, UI_SET_EVBIT, EV_ABS);
+		struct uinput_abs_setup axis;
+		memset(&axis, 0, sizeof(axis));
+		axis.absinfo.maximum = 255;
+		if (slider) {
+			axis.code = ABS_X;
+			ioctl(fd, UI_SET_ABSBIT, ABS_X);
+			ioctl(fd, UI_ABS_SETUP, &axis);
+		}
+		if (wheel) {
+			axis.code = ABS_WHEEL;
+			ioctl(fd, UI_SET_ABSBIT, ABS_WHEEL);
+			ioctl(fd, UI_ABS_SETUP, &axis);
+		}
+	}
+
+	struct uinput_setup setup;
+	memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x0001;
+	setup.id.product = 0x0001;
+	strncpy(setup.name, "DigitalTouch", UINPUT_MAX_NAME_SIZE - 1);
+	if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// function addEvent
+// appends one event to the batch of the current scan
+static void addEvent(std::vector<struct input_event> &batch, uint16_t type, uint16_t code, int32_t value)
+{
+	struct input_event event;
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.code = code;
+	event.value = value;
+	batch.push_back(event);
+}
+
+// input of the simulation mode, read with read() so poll() sees all data that is not processed
+struct Input {
+	char data[4 * maxSensors + 16];
+	size_t length;
+	bool end;
+};
+
+// function readInput
+// simulation mode: appends the available data of stdin to the buffer, sets "end" at the end of input
+static void readInput(Input &input)
+{
+	ssize_t length = read(STDIN_FILENO, input.data + input.length, sizeof(input.data) - 1 - input.length);
+	if (length < 0 && errno == EINTR) return;
+	if (length <= 0) input.end = true;
+	else input.length += (size_t)length;
+}
+
+// function readValues
+// simulation mode: takes the raw values of one scan (one complete line) from the buffer,
+// returns false if there is no complete line (the last line may end without newline)
+static bool readValues(Input &input, uint8_t *values, uint8_t count)
+{
+	char *newline = (char *)memchr(input.data, '\n', input.length);
+	size_t used;
+	if (newline) used = (size_t)(newline - input.data) + 1;
+	else if (input.length == sizeof(input.data) - 1 || (input.end && input.length > 0)) used = input.length;
+	else return false;
+
+	if (newline) *newline = 0;
+	else input.data[input.length] = 0;
+	char *position = input.data;
+	for (uint8_t i = 0; i < count; i++) {
+		char *end;
+		unsigned long value = strtoul(position, &end, 10);
+		values[i] = (end == position || value > 255) ? 255 : (uint8_t)value;
+		position = end;
+	}
+	input.length -= used;
+	memmove(input.data, input.data + used, input.length);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint8_t samples = 5;
+	uint8_t threads = 4;
+	long period = 20;
+	int option;
+	while ((option = getopt(argc, argv, "n:t:p:")) != -1) {
+		if (option == 'n') samples = (uint8_t)atoi(optarg);
+		else if (option == 't') threads = (uint8_t)atoi(optarg);
+		else if (option == 'p') period = atol(optarg);
+		else return 1;
+	}
+	if (optind + 2 > argc || period <= 0) {
+		fprintf(stderr, "usage: %s [-n samples] [-t threads] [-p ms] <chip>|- <sensor> ...\n", argv[0]);
+		return 1;
+	}
+	const char *chip = argv[optind];
+	bool simulation = strcmp(chip, "-") == 0;
+	for (int i = optind + 1; i < argc; i++) {
+		if (!parseSensor(argv[i])) {
+			fprintf(stderr, "invalid sensor: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (sensors.size() > maxSensors) {
+		fprintf(stderr, "too many sensors\n");
+		return 1;
+	}
+
+	// sensors of the slider and the wheel in their order, all other arrays in command line order
+	uint8_t count = (uint8_t)sensors.size();
+	uint8_t pins[maxSensors], values[maxSensors], states[maxSensors];
+	uint8_t sliderPins[maxSensors], wheelPins[maxSensors];
+	int8_t deltas[maxSensors], sliderDeltas[maxSensors], wheelDeltas[maxSensors];
+	uint16_t refs[maxSensors];
+	uint8_t sliderCount = 0;
+	uint8_t wheelCount = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		pins[i] = i;
+		refs[i] = 0xFFFF;
+		states[i] = 0;
+		if (sensors[i].kind == SLIDER) sliderPins[sliderCount++] = i;
+		if (sensors[i].kind == WHEEL) wheelPins[wheelCount++] = i;
+		if (!simulation && digitalTouchGpioBegin(i, chip, sensors[i].line) < 0) {
+			fprintf(stderr, "%s line %u: %s\n", chip, sensors[i].line, strerror(errno));
+			return 1;
+		}
+	}
+
+	int device = createDevice(sliderCount > 0, wheelCount > 0);
+	if (device < 0) {
+		fprintf(stderr, "/dev/uinput: %s\n", strerror(errno));
+		return 1;
+	}
+
+	// SIGINT and SIGTERM end the loop, so the device is removed properly
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigprocmask(SIG_BLOCK, &signals, NULL);
+	int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+
+	// the scan timer, not used in simulation mode (stdin paces the scans)
+	int timerFd = -1;
+	if (!simulation) {
+		timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		struct itimerspec interval;
+		interval.it_interval.tv_sec = period / 1000;
+		interval.it_interval.tv_nsec = (period % 1000) * 1000000L;
+		interval.it_value = interval.it_interval;
+		timerfd_settime(timerFd, 0, &interval, NULL);
+	}
+
+	struct pollfd waitFds[2] = { { signalFd, POLLIN, 0 }, { simulation ? STDIN_FILENO : timerFd, POLLIN, 0 } };
+	int16_t lastSlider = DIGITALTOUCH_NO_POSITION;
+	int16_t lastWheel = DIGITALTOUCH_NO_POSITION;
+	bool running = true;
+	std::vector<struct input_event> batch;
+	Input input;
+	input.length = 0;
+	input.end = false;
+
+	while (running && poll(waitFds, 2, -1) >= 0) {
+		if (waitFds[0].revents) break;
+		if (!waitFds[1].revents) continue;
+
+		// measure all sensors, or read all available lines (one scan per line)
+		if (simulation) {
+			readInput(input);
+			running = !input.end;
+		} else {
+			uint64_t expirations;
+			if (read(timerFd, &expirations, sizeof(expirations)) < 0) continue;
+			digitalTouchGpioScan(pins, count, values, samples, threads);
+		}
+		while (!simulation || readValues(input, values, count)) {
+			digitalTouchDeltas(deltas, values, refs, count, offset);
+
+			// keys
+			batch.clear();
+			for (uint8_t i = 0; i < count; i++) {
+				if (sensors[i].kind != KEY) continue;
+				uint8_t event = digitalTouchEvent(&states[i], deltas[i], sensorThreshold, confirmScans);
+				if (event != DIGITALTOUCH_NONE) addEvent(batch, EV_KEY, sensors[i].code, event == DIGITALTOUCH_PRESS);
+			}
+
+			// slider and wheel
+			for (uint8_t i = 0; i < sliderCount; i++) sliderDeltas[i] = deltas[sliderPins[i]];
+			for (uint8_t i = 0; i < wheelCount; i++) wheelDeltas[i] = deltas[wheelPins[i]];
+			int16_t slider = digitalTouchSlider(sliderDeltas, sliderCount, sensorThreshold, false);
+			int16_t wheel = digitalTouchSlider(wheelDeltas, wheelCount, sensorThreshold, true);
+			bool touched = slider != DIGITALTOUCH_NO_POSITION || wheel != DIGITALTOUCH_NO_POSITION;
+			bool wasTouched = lastSlider != DIGITALTOUCH_NO_POSITION || lastWheel != DIGITALTOUCH_NO_POSITION;
+			if (touched != wasTouched) addEvent(batch, EV_KEY, BTN_TOUCH, touched);
+			if (slider != DIGITALTOUCH_NO_POSITION && slider != lastSlider) addEvent(batch, EV_ABS, ABS_X, slider);
+			if (wheel != DIGITALTOUCH_NO_POSITION && wheel != lastWheel) addEvent(batch, EV_ABS, ABS_WHEEL, wheel);
+			lastSlider = slider;
+			lastWheel = wheel;
+
+			// all events of the scan at once
+			if (!batch.empty()) {
+				addEvent(batch, EV_SYN, SYN_REPORT, 0);
+				if (write(device, batch.data(), batch.size() * sizeof(struct input_event)) < 0) {
+					fprintf(stderr, "/dev/uinput: %s\n", strerror(errno));
+				}
+			}
+
+			// self calibrate and cool down
+			for (uint8_t i = 0; i < count; i++) refs[i] = digitalTouchCalibrate(refs[i], values[i], offset);
+
+			// one scan per timer expiration
+			if (!simulation) break;
+		}
+	}
+
+	ioctl(device, UI_DEV_DESTROY);
+	close(device);
+	for (uint8_t i = 0; i < count; i++) digitalTouchGpioEnd(i);
+	return 0;
+}
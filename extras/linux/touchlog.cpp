@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchlog
+
+Decodes the event log of DigitalTouchLog.h from an EEPROM dump, oldest record first. The end of
+the log is found with the same code as on the controller.
+
+usage: touchlog <dump> [<start> [<size>]]
+  <dump>   binary EEPROM dump, e.g. avrdude -p m328p -c usbasp -U eeprom:r:log.bin:r
+  <start>  EEPROM address of the log (default 0), as in DigitalTouchLog.start
+  <size>   number of records of the log (default: up to the end of the dump)
+
+Output, one line per record: boot counter, time (with the wraps of the 16 bit time counted
+since the boot), type, sensor, data (signed for deltas).
+
+for more comments see DigitalTouchLog.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+
+// the log reads from the dump instead of the EEPROM
+static std::vector<uint8_t> dump;
+#define digitalTouchLogReadByte(address)         (dump[(address)])
+#define digitalTouchLogWriteByte(address, value) (void)0
+#define digitalTouchLogReady()                   true
+#include "../../DigitalTouchLog.h"
+
+static const char *typeNames[8] = { "boot", "press", "release", "overflow", "stuck", "baseline", "noise", "empty" };
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "usage: touchlog <dump> [<start> [<size>]]\n");
+		return 1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (!file) {
+		perror(argv[1]);
+		return 1;
+	}
+	int c;
+	while ((c = fgetc(file)) != EOF) dump.push_back((uint8_t)c);
+	fclose(file);
+
+	DigitalTouchLog log = DigitalTouchLog();
+	unsigned long start = argc > 2 ? strtoul(argv[2], NULL, 0) : 0;
+	if (start >= dump.size()) {
+		fprintf(stderr, "start %lu is outside of the dump (%zu bytes)\n", start, dump.size());
+		return 1;
+	}
+	unsigned long size = argc > 3 ? strtoul(argv[3], NULL, 0) : (dump.size() - start) / DIGITALTOUCH_LOG_RECORD;
+	if (size == 0 || size > 0xFFFF || start + size * DIGITALTOUCH_LOG_RECORD > dump.size()) {
+		fprintf(stderr, "log of %lu records does not fit into the dump\n", size);
+		return 1;
+	}
+	log.start = (uint16_t)start;
+	log.size = (uint16_t)size;
+	digitalTouchLogFind(&log);
+
+	// from the oldest to the newest record
+	printf("boot\ttime\ttype\tsensor\tdata\n");
+	unsigned boot = 0;
+	unsigned long time = 0;
+	uint16_t last = 0;
+	for (uint16_t n = 0; n < log.size; n++) {
+		uint16_t i = log.head + n;
+		if (i >= log.size) i -= log.size;
+		const uint8_t *record = &dump[log.start + i * DIGITALTOUCH_LOG_RECORD];
+		uint8_t type = (record[0] >> 4) & 7;
+		if (type == DIGITALTOUCH_LOG_EMPTY) continue;
+		uint8_t sensor = record[0] & 0x0F;
+		uint8_t data = record[1];
+		uint16_t stamp = (uint16_t)(record[2] | (record[3] << 8));
+
+		// time since the boot, a smaller stamp is a wrap of the counter
+		if (type == DIGITALTOUCH_LOG_BOOT) {
+			boot = data;
+			time = stamp;
+		} else {
+			time += (uint16_t)(stamp - last);
+		}
+		last = stamp;
+
+		bool delta = type == DIGITALTOUCH_LOG_PRESS || type == DIGITALTOUCH_LOG_RELEASE || type == DIGITALTOUCH_LOG_STUCK || type == DIGITALTOUCH_LOG_NOISE;
+		printf("%u\t%lu\t%s\t%u\t%d\n", boot, time, typeNames[type], sensor, delta ? (int)(int8_t)data : (int)data);
+	}
+	return 0;
+}
@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchscan
+
+Same as the example sketch DigitalTouch.ino, but for single-board computers. Every line given
+on the command line is a touch sensor. The values are printed like in the example sketch.
+
+usage: touchscan <chip> <line offset> [<line offset> ...]
+e.g.:  touchscan /dev/gpiochip0 17 27 22
+
+for more comments see DigitalTouchGpio.h and the documentation in the library file DigitalTouch.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "DigitalTouchGpio.h"
+
+// level of filtering for self calibration
+#define offset 4
+
+// number of samples averaged for each measurement
+#define samples 5
+
+// number of additional counts over baseline that indicate a touched sensor
+#define sensorThreshold 4
+
+// number of measuring threads
+#define threads 4
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3 || argc - 2 > DIGITALTOUCH_GPIO_PINS) {
+		fprintf(stderr, "usage: %s <chip> <line offset> [<line offset> ...]\n", argv[0]);
+		return 1;
+	}
+
+	uint8_t count = (uint8_t)(argc - 2);
+	uint8_t pins[DIGITALTOUCH_GPIO_PINS];
+	uint8_t values[DIGITALTOUCH_GPIO_PINS];
+	uint16_t refs[DIGITALTOUCH_GPIO_PINS];
+	for (uint8_t i = 0; i < count; i++) {
+		pins[i] = i;
+		refs[i] = 0xFFFF;
+		if (digitalTouchGpioBegin(i, argv[1], (uint32_t)strtoul(argv[i + 2], NULL, 0)) < 0) {
+			fprintf(stderr, "%s line %s: %s\n", argv[1], argv[i + 2], strerror(errno));
+			return 1;
+		}
+	}
+
+	for (;;) {
+		digitalTouchGpioScan(pins, count, values, samples, threads);
+
+		for (uint8_t i = 0; i < count; i++) {
+			int16_t delta = digitalTouchDelta(values[i], refs[i], offset);
+			// touched?, calibrated value, raw value, raw ref
+			printf("%d\t%d\t%u\t%u\t%u\t\t", delta > sensorThreshold, delta, values[i], refs[i] >> offset, refs[i]);
+			refs[i] = digitalTouchCalibrate(refs[i], values[i], offset);
+		}
+		printf("\n");
+		fflush(stdout);
+
+		// Wait some time
+		usleep(100000);
+	}
+}
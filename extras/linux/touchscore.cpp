@@ -0,0 +1,347 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchscore
+
+Scores the detection of the library (filter, baseline, events) on recorded traces with known
+touches, so the number of samples, the filter and the thresholds can be chosen by numbers:
+precision, recall, latency and CPU cycles per scan for every configuration.
+
+Trace (CSV, one line per sensor and scan, lines starting with # are ignored):
+  <scan>,<sensor>,<touched>,<sample>,<sample>,...
+  scan and sensor are numbers starting with 0, the lines of one scan are together
+  touched is the truth (1 = a finger is on the sensor, 0 = not, also for water, objects, LEDs)
+  the samples are the raw results of digitalTouchRead() in the order of the reads: first the read
+  that the filters ignore (see DIGITALTOUCH_NO_DISCARD), then as many as the highest "samples"
+  to test, so the ignored read after a LED was on is recorded but not used, as on the controller
+Record the traces with a sketch that prints the raw samples, and mark the touches e.g. with a
+button of the test setup. Use one file per situation (clean touches, noise, water, gloves, LED
+switching, long presses), the result is printed per file and for all files. The folder traces
+has synthetic examples of these situations ("make score").
+
+usage: touchscore [options] <trace.csv> [<trace.csv> ...]
+options (lists are separated by commas):
+  -f <filters>     average, median, sum (default average,median)
+  -n <samples>     samples for average and sum (default 1,3,5), the median takes 3
+  -T <thresholds>  thresholds of digitalTouchEvent (default 3,4,6,8)
+  -c <confirm>     confirmation scans (default 1,2)
+  -o <offsets>     offsets of the baseline (default 4)
+  -C <cycles>      CPU cycles per count of the measuring loop, 1..255 (default 5)
+  -d               the traces have no ignored first read (firmware with DIGITALTOUCH_NO_DISCARD)
+  -v               print the result of every file
+
+A press is correct if it is reported while the sensor is touched and it is the first press of
+this touch, otherwise it is false. A touch without a press is missed. The latency is the number
+of scans from the start of a touch to its press. The CPU cycles include the ignored first read
+(not with -d) and 40 cycles per sample outside of the loop, as in extras/linux/touchenergy.
+
+for more comments see the documentation in the library files
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "DigitalTouchGpio.h"
+#include "../../DigitalTouchEvents.h"
+#include "../../DigitalTouchEnergy.h"
+
+// CPU cycles per sample outside of the measuring loop
+#define sampleOverhead 40
+
+// filters of a configuration
+enum Filter { AVERAGE, MEDIAN, SUM };
+static const char *filterNames[] = { "average", "median", "sum" };
+
+// one scan of one sensor
+struct Sample {
+	bool touched;
+	std::vector<uint8_t> samples;
+};
+
+// one trace file: sensors[sensor][scan]
+struct Trace {
+	std::string name;
+	std::vector<std::vector<Sample> > sensors;
+};
+
+// configuration and result
+struct Config {
+	Filter filter;
+	uint8_t samples;
+	uint8_t threshold;
+	uint8_t confirm;
+	uint8_t offset;
+};
+
+struct Score {
+	unsigned long correct, wrong, missed;
+	unsigned long latency; // sum of the latency of the correct presses
+	double cycles;         // sum over all scans
+	unsigned long scans;
+};
+
+// function parseList
+// comma separated numbers
+static std::vector<int> parseList(const char *text)
+{
+	std::vector<int> list;
+	while (*text) {
+		char *end;
+		long value = strtol(text, &end, 10);
+		if (end == text) break;
+		list.push_back((int)value);
+		text = *end == ',' ? end + 1 : end;
+	}
+	return list;
+}
+
+// function readTrace
+// reads a CSV trace, returns false on errors
+static bool readTrace(const char *path, Trace &trace)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		perror(path);
+		return false;
+	}
+	trace.name = path;
+	char line[1024];
+	unsigned number = 0;
+	while (fgets(line, sizeof(line), file)) {
+		number++;
+		// a line longer than the buffer would be split into two rows
+		if (!strchr(line, '\n') && !feof(file)) {
+			fprintf(stderr, "%s:%u: line longer than %zu characters\n", path, number, sizeof(line) - 2);
+			fclose(file);
+			return false;
+		}
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+		std::vector<int> fields = parseList(line);
+		if (fields.size() < 4 || fields[0] < 0 || fields[1] < 0 || fields[1] > 255) {
+			fprintf(stderr, "%s:%u: expected <scan>,<sensor>,<touched>,<sample>...\n", path, number);
+			fclose(file);
+			return false;
+		}
+		size_t sensor = (size_t)fields[1];
+		size_t scan = (size_t)fields[0];
+		if (trace.sensors.size() <= sensor) trace.sensors.resize(sensor + 1);
+		std::vector<Sample> &scans = trace.sensors[sensor];
+		if (scans.size() != scan) {
+			fprintf(stderr, "%s:%u: scan %zu of sensor %zu out of order\n", path, number, scan, sensor);
+			fclose(file);
+			return false;
+		}
+		Sample sample;
+		sample.touched = fields[2] != 0;
+		for (size_t i = 3; i < fields.size(); i++) sample.samples.push_back(fields[i] < 0 ? 0 : (fields[i] > 255 ? 255 : (uint8_t)fields[i]));
+		scans.push_back(sample);
+	}
+	fclose(file);
+	return true;
+}
+
+// function filterValue
+// the value of the filter from the recorded samples, false if there are not enough samples
+// "discard" is 1 if the first sample is the ignored read, 0 without it
+static bool filterValue(const Config &config, const std::vector<uint8_t> &samples, uint8_t discard, uint8_t &value, double &cycles, uint8_t cyclesPerCount)
+{
+	uint8_t used = config.filter == MEDIAN ? 3 : config.samples;
+	if (samples.size() < (size_t)used + discard) return false;
+	const uint8_t *data = samples.data() + discard;
+
+	// the ignored read takes time but is not used
+	if (discard) cycles += (double)samples[0] * cyclesPerCount + sampleOverhead;
+	uint16_t sum = 0;
+	for (uint8_t i = 0; i < used; i++) {
+		sum += data[i];
+		cycles += (double)data[i] * cyclesPerCount + sampleOverhead;
+	}
+
+	if (config.filter == MEDIAN) value = digitalTouchMedian3(data[0], data[1], data[2]);
+	else if (config.filter == SUM) value = sum > 255 ? 255 : (uint8_t)sum;
+	else value = (uint8_t)(sum / used);
+	return true;
+}
+
+// function scoreTrace
+// runs the detection of one configuration over a trace, returns false if samples are missing
+static bool scoreTrace(const Config &config, const Trace &trace, Score &score, uint8_t discard, uint8_t cyclesPerCount)
+{
+	size_t scans = 0;
+	for (size_t sensor = 0; sensor < trace.sensors.size(); sensor++) {
+		const std::vector<Sample> &samples = trace.sensors[sensor];
+		if (samples.size() > scans) scans = samples.size();
+		uint16_t ref = 0xFFFF;
+		uint8_t state = 0;
+		bool pressed = false; // a press was reported in the current touch
+		size_t start = 0;     // scan of the start of the current touch
+
+		for (size_t scan = 0; scan < samples.size(); scan++) {
+			const Sample &sample = samples[scan];
+			uint8_t value;
+			if (!filterValue(config, sample.samples, discard, value, score.cycles, cyclesPerCount)) return false;
+
+			// start and end of a touch of the truth
+			bool touched = sample.touched;
+			bool before = scan > 0 && samples[scan - 1].touched;
+			if (touched && !before) {
+				start = scan;
+				pressed = false;
+			}
+			if (!touched && before && !pressed) score.missed++;
+
+			// detection as in the example sketch
+			int16_t delta = digitalTouchDelta(value, ref, config.offset);
+			int8_t saturated = delta > 127 ? 127 : (delta < -128 ? -128 : (int8_t)delta);
+			if (digitalTouchEvent(&state, saturated, config.threshold, config.confirm) == DIGITALTOUCH_PRESS) {
+				if (touched && !pressed) {
+					score.correct++;
+					score.latency += scan - start;
+					pressed = true;
+				} else {
+					score.wrong++;
+				}
+			}
+			ref = digitalTouchCalibrate(ref, value, config.offset);
+		}
+		// touch until the end of the trace
+		if (!samples.empty() && samples.back().touched && !pressed) score.missed++;
+	}
+	score.scans += scans;
+	return true;
+}
+
+// function printScore
+// one line of the result
+static void printScore(const char *name, const Config &config, const Score &score)
+{
+	unsigned long presses = score.correct + score.wrong;
+	unsigned long touches = score.correct + score.missed;
+	double precision = presses ? (double)score.correct / presses : 1.0;
+	double recall = touches ? (double)score.correct / touches : 1.0;
+	double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+	double latency = score.correct ? (double)score.latency / score.correct : 0.0;
+	double cycles = score.scans ? score.cycles / score.scans : 0.0;
+	printf("%-8s %3u %3u %3u %3u  %6lu %6lu %6lu  %5.3f %5.3f %5.3f  %6.2f  %8.0f  %s\n", filterNames[config.filter],
+		config.filter == MEDIAN ? 3 : config.samples, config.threshold, config.confirm, config.offset, score.correct, score.wrong,
+		score.missed, precision, recall, f1, latency, cycles, name);
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<int> filters = { AVERAGE, MEDIAN };
+	std::vector<int> samples = { 1, 3, 5 };
+	std::vector<int> thresholds = { 3, 4, 6, 8 };
+	std::vector<int> confirms = { 1, 2 };
+	std::vector<int> offsets = { 4 };
+	uint8_t cyclesPerCount = DIGITALTOUCH_CYCLES_HARDCODED;
+	uint8_t discard = 1;
+	bool verbose = false;
+	int option;
+	while ((option = getopt(argc, argv, "f:n:T:c:o:C:dv")) != -1) {
+		if (option == 'f') {
+			filters.clear();
+			std::string list = optarg;
+			for (int f = AVERAGE; f <= SUM; f++) {
+				if (list.find(filterNames[f]) != std::string::npos) filters.push_back(f);
+			}
+		}
+		else if (option == 'n') samples = parseList(optarg);
+		else if (option == 'T') thresholds = parseList(optarg);
+		else if (option == 'c') confirms = parseList(optarg);
+		else if (option == 'o') offsets = parseList(optarg);
+		else if (option == 'C') {
+			int cycles = atoi(optarg);
+			if (cycles < 1 || cycles > 255) {
+				fprintf(stderr, "-C: cycles per count must be 1..255\n");
+				return 1;
+			}
+			cyclesPerCount = (uint8_t)cycles;
+		}
+		else if (option == 'd') discard = 0;
+		else if (option == 'v') verbose = true;
+		else return 1;
+	}
+	if (optind >= argc || filters.empty() || samples.empty() || thresholds.empty() || confirms.empty() || offsets.empty()) {
+		fprintf(stderr, "usage: %s [-f filters] [-n samples] [-T thresholds] [-c confirm] [-o offsets] [-C cycles] [-d] [-v] <trace.csv> ...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<Trace> traces(argc - optind);
+	for (int i = optind; i < argc; i++) {
+		if (!readTrace(argv[i], traces[i - optind])) return 1;
+	}
+
+	// all configurations
+	std::vector<Config> configs;
+	for (int f : filters) {
+		for (int n : samples) {
+			if (n < 1 || n > 255) continue;
+			// the median always takes 3 samples
+			if (f == MEDIAN && n != samples[0]) continue;
+			for (int t : thresholds) {
+				for (int c : confirms) {
+					for (int o : offsets) {
+						if (t < 0 || t > 127 || c < 1 || c > 127 || o < 0 || o > 8) continue;
+						Config config = { (Filter)f, (uint8_t)n, (uint8_t)t, (uint8_t)c, (uint8_t)o };
+						configs.push_back(config);
+					}
+				}
+			}
+		}
+	}
+
+	printf("filter   smp thr cnf off  correct wrong missed  prec  recall F1     latency cycles/scan\n");
+	double bestF1 = -1, bestEfficiency = -1;
+	Config bestF1Config = Config(), bestEfficiencyConfig = Config();
+	for (const Config &config : configs) {
+		Score total = Score();
+		bool complete = true;
+		for (const Trace &trace : traces) {
+			Score score = Score();
+			if (!scoreTrace(config, trace, score, discard, cyclesPerCount)) {
+				complete = false;
+				break;
+			}
+			if (verbose) printScore(trace.name.c_str(), config, score);
+			total.correct += score.correct;
+			total.wrong += score.wrong;
+			total.missed += score.missed;
+			total.latency += score.latency;
+			total.cycles += score.cycles;
+			total.scans += score.scans;
+		}
+		// not enough samples recorded for this configuration
+		if (!complete) continue;
+		printScore("all", config, total);
+
+		// best detection and best detection per CPU cycle
+		unsigned long presses = total.correct + total.wrong;
+		unsigned long touches = total.correct + total.missed;
+		double precision = presses ? (double)total.correct / presses : 1.0;
+		double recall = touches ? (double)total.correct / touches : 1.0;
+		double f1 = precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0.0;
+		double cycles = total.scans ? total.cycles / total.scans : 1.0;
+		if (f1 > bestF1) {
+			bestF1 = f1;
+			bestF1Config = config;
+		}
+		if (f1 / cycles > bestEfficiency) {
+			bestEfficiency = f1 / cycles;
+			bestEfficiencyConfig = config;
+		}
+	}
+	if (bestF1 < 0) {
+		fprintf(stderr, "no configuration could be scored, are there enough samples in the traces?\n");
+		return 1;
+	}
+	printf("\nbest F1:           %s, %u samples, threshold %u, confirm %u, offset %u (F1 %.3f)\n", filterNames[bestF1Config.filter],
+		bestF1Config.filter == MEDIAN ? 3 : bestF1Config.samples, bestF1Config.threshold, bestF1Config.confirm, bestF1Config.offset, bestF1);
+	printf("best F1 per cycle: %s, %u samples, threshold %u, confirm %u, offset %u\n", filterNames[bestEfficiencyConfig.filter],
+		bestEfficiencyConfig.filter == MEDIAN ? 3 : bestEfficiencyConfig.samples, bestEfficiencyConfig.threshold, bestEfficiencyConfig.confirm,
+		bestEfficiencyConfig.offset);
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch on Linux: touchtelemetry
+
+Decodes the compressed telemetry of DigitalTouchTelemetry.h from a serial port (or stdin) and
+prints one line per scan with the values of all sensors, separated by tabs. Frames after a lost
+frame are skipped until the next keyframe, the number of errors is printed at the end.
+
+usage: touchtelemetry [-b baud] <port>|- <count>
+       touchtelemetry -e <count> [interval]
+  <port>     serial port (e.g. /dev/ttyUSB0), set to raw mode with the given baud rate
+  -          read the frames from stdin
+  <count>    number of sensors
+  -b <baud>  baud rate of the port (default 115200)
+  -e         encode: reads one line of values per scan from stdin and writes the frames to
+             stdout, with a keyframe every "interval" frames (default 32), for tests:
+             ./touchtelemetry -e 4 < trace.txt | ./touchtelemetry - 4
+
+for more comments see DigitalTouchTelemetry.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "../../DigitalTouchTelemetry.h"
+
+// maximum number of sensors, a frame must fit into 255 bytes
+#define maxSensors DIGITALTOUCH_TELEMETRY_MAX
+
+// function baudRate
+// termios constant of a baud rate, 0 if not supported
+static speed_t baudRate(long baud)
+{
+	switch (baud) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		case 460800: return B460800;
+		case 500000: return B500000;
+		case 1000000: return B1000000;
+		default: return 0;
+	}
+}
+
+// function openPort
+// opens a serial port in raw mode, returns the file descriptor or -1
+static int openPort(const char *path, long baud)
+{
+	int fd = open(path, O_RDONLY | O_NOCTTY);
+	if (fd < 0) return -1;
+	struct termios settings;
+	if (isatty(fd) && tcgetattr(fd, &settings) == 0) {
+		cfmakeraw(&settings);
+		speed_t speed = baudRate(baud);
+		if (speed == 0) {
+			close(fd);
+			errno = EINVAL;
+			return -1;
+		}
+		cfsetispeed(&settings, speed);
+		cfsetospeed(&settings, speed);
+		tcsetattr(fd, TCSANOW, &settings);
+	}
+	return fd;
+}
+
+// function encode
+// test mode: encodes the values on stdin into frames on stdout
+static int encode(uint8_t count, uint8_t interval)
+{
+	uint8_t previous[maxSensors];
+	uint8_t values[maxSensors];
+	uint8_t frame[DIGITALTOUCH_TELEMETRY_SIZE(maxSensors)];
+	DigitalTouchTelemetry telemetry = { previous, count, interval, 0, 0 };
+	char line[4 * maxSensors + 16];
+	while (fgets(line, sizeof(line), stdin)) {
+		char *position = line;
+		for (uint8_t i = 0; i < count; i++) {
+			char *end;
+			unsigned long value = strtoul(position, &end, 10);
+			values[i] = (end == position || value > 255) ? 255 : (uint8_t)value;
+			position = end;
+		}
+		uint8_t length = digitalTouchTelemetryEncode(&telemetry, values, frame);
+		fwrite(frame, 1, length, stdout);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	long baud = 115200;
+	bool encoder = false;
+	int option;
+	while ((option = getopt(argc, argv, "b:e")) != -1) {
+		if (option == 'b') baud = atol(optarg);
+		else if (option == 'e') encoder = true;
+		else return 1;
+	}
+
+	if (encoder) {
+		if (optind >= argc) {
+			fprintf(stderr, "usage: %s -e <count> [interval]\n", argv[0]);
+			return 1;
+		}
+		int count = atoi(argv[optind]);
+		int interval = optind + 1 < argc ? atoi(argv[optind + 1]) : 32;
+		if (count < 1 || count > maxSensors || interval < 1 || interval > 255) {
+			fprintf(stderr, "count must be 1..%d, interval 1..255\n", maxSensors);
+			return 1;
+		}
+		return encode((uint8_t)count, (uint8_t)interval);
+	}
+
+	if (optind + 2 != argc) {
+		fprintf(stderr, "usage: %s [-b baud] <port>|- <count>\n", argv[0]);
+		return 1;
+	}
+	int count = atoi(argv[optind + 1]);
+	if (count < 1 || count > maxSensors) {
+		fprintf(stderr, "count must be 1..%d\n", maxSensors);
+		return 1;
+	}
+	int fd = strcmp(argv[optind], "-") == 0 ? 0 : openPort(argv[optind], baud);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+
+	uint8_t values[maxSensors];
+	uint8_t frame[DIGITALTOUCH_TELEMETRY_SIZE(maxSensors)];
+	DigitalTouchTelemetryDecoder decoder = DigitalTouchTelemetryDecoder();
+	decoder.values = values;
+	decoder.count = (uint8_t)count;
+	decoder.frame = frame;
+
+	uint8_t buffer[256];
+	ssize_t received;
+	while ((received = read(fd, buffer, sizeof(buffer))) > 0) {
+		for (ssize_t i = 0; i < received; i++) {
+			if (!digitalTouchTelemetryDecode(&decoder, buffer[i])) continue;
+			for (int j = 0; j < count; j++) printf(j < count - 1 ? "%u\t" : "%u\n", values[j]);
+		}
+	}
+	fflush(stdout);
+	if (decoder.errors) fprintf(stderr, "%u frames lost or damaged\n", decoder.errors);
+	return 0;
+}
@@ -0,0 +1,416 @@
+/*
+Copyright (c) 2019 Rainer Urlacher
+
+DigitalTouch simulation: touchsim
+
+Runs a compiled sketch (ELF file) in the AVR simulator simavr with virtual touch sensors.
+Every sensor pin is connected to a model of the RC circuit: when the sketch switches the pin to
+input, the input gets HIGH after the charging time R * C * ln(1 / (1 - Vth / Vdd)). A touch adds
+capacitance for a given time, so the sketch sees touches without hardware. The output of the
+serial port is printed with the simulated time, and the measuring window of every sensor (cycles
+from input to output, the busy loop of digitalTouchRead) is counted for cycle statistics.
+
+usage: touchsim [options] <firmware.elf> <pad> [<pad> ...] [<touch> ...]
+  <pad>     pad:<port><bit>:<pF>                  e.g. pad:B0:10 (Arduino Mega pin 53)
+  <touch>   touch:<port><bit>:<from ms>:<to ms>:<pF>  e.g. touch:B0:500:1500:5
+options:
+  -m <mcu>   MCU (default atmega2560, the example sketch uses pins 53 and 51)
+  -f <Hz>    CPU clock (default 16000000)
+  -t <ms>    simulated time (default 3000)
+  -r <Ohm>   Rp of all pads (default 1000000)
+  -v <%>     input threshold in % of Vdd (default 60, VIH of the ATmega)
+check mode (integration test, exit status 1 if a check fails):
+  -e <text>[@<from ms>:<to ms>]  a line of the serial output starts with <text> (\t for a tab),
+                                 if given in the time from..to
+  -x <text>[@<from ms>:<to ms>]  no line starts with <text> (in the time from..to)
+  -w <port><bit>:<min>:<max>     the mean measuring window of the pad is min..max cycles
+
+Build the sketch e.g. with
+  arduino-cli compile -b arduino:avr:mega --output-dir build ../../examples/DigitalTouch
+  ./touchsim build/DigitalTouch.ino.elf pad:B0:10 pad:B2:10 touch:B0:1000:2000:5
+and checked with "make check" (see the Makefile for the expected ranges)
+
+The model only covers sensors with an external Rp (not sensorx_pullup, sensorx_adc, sensorx_acomp).
+
+for more comments see the documentation in the library file DigitalTouch.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_irq.h>
+#include <sim_cycle_timers.h>
+#include <avr_ioport.h>
+#include <avr_uart.h>
+
+#define maxPads    16
+#define maxTouches 64
+#define maxChecks  32
+
+// one sensor pin with its RC circuit
+typedef struct {
+	char port;
+	uint8_t bit;
+	double capacitance;       // pF without touch
+	avr_irq_t *irq;           // input of the pin
+	int input;                // pin is input (charging)
+	avr_cycle_count_t start;  // cycle of the switch to input
+	// statistics of the measuring window in cycles
+	unsigned long windows;
+	avr_cycle_count_t minimum, maximum;
+	double sum;
+} Pad;
+
+// additional capacitance of a pad for a time
+typedef struct {
+	int pad;
+	double from, to; // ms
+	double capacitance;
+} Touch;
+
+// expected (or unexpected) serial output
+typedef struct {
+	char text[64];
+	double from, to;  // ms
+	int expected;     // 1: must appear, 0: must not appear
+	double found;     // ms of the first matching line, -1 if none
+} OutputCheck;
+
+// expected range of the mean measuring window of a pad
+typedef struct {
+	char name[3];
+	double minimum, maximum;
+} WindowCheck;
+
+static avr_t *avr;
+static Pad pads[maxPads];
+static int padCount;
+static Touch touches[maxTouches];
+static int touchCount;
+static double resistance = 1e6;
+static double threshold = 0.6;
+static OutputCheck outputChecks[maxChecks];
+static int outputCheckCount;
+static WindowCheck windowChecks[maxChecks];
+static int windowCheckCount;
+
+// function findPad
+// index of the pad "B0", -1 if unknown
+static int findPad(const char *name)
+{
+	for (int i = 0; i < padCount; i++) {
+		if (pads[i].port == name[0] && pads[i].bit == name[1] - '0') return i;
+	}
+	return -1;
+}
+
+// function timeMs
+// simulated time in ms
+static double timeMs(void)
+{
+	return (double)avr->cycle * 1000.0 / avr->frequency;
+}
+
+// function charged
+// cycle timer: the input of the pad gets HIGH
+static avr_cycle_count_t charged(avr_t *avr, avr_cycle_count_t when, void *param)
+{
+	(void)avr;
+	(void)when;
+	Pad *pad = (Pad *)param;
+	if (pad->input) avr_raise_irq(pad->irq, 1);
+	return 0;
+}
+
+// function directionChanged
+// the sketch wrote a DDR register: start or stop the charging of its pads
+static void directionChanged(avr_irq_t *irq, uint32_t value, void *param)
+{
+	(void)irq;
+	char port = (char)(intptr_t)param;
+	for (int i = 0; i < padCount; i++) {
+		Pad *pad = &pads[i];
+		if (pad->port != port) continue;
+		int input = !(value & (1 << pad->bit));
+		if (input == pad->input) continue;
+		pad->input = input;
+
+		if (input) {
+			// discharged pad, HIGH after the charging time
+			double capacitance = pad->capacitance;
+			double now = timeMs();
+			for (int t = 0; t < touchCount; t++) {
+				if (touches[t].pad == i && now >= touches[t].from && now < touches[t].to) capacitance += touches[t].capacitance;
+			}
+			double seconds = resistance * capacitance * 1e-12 * log(1.0 / (1.0 - threshold));
+			avr_cycle_count_t cycles = (avr_cycle_count_t)(seconds * avr->frequency) + 1;
+			pad->start = avr->cycle;
+			avr_raise_irq(pad->irq, 0);
+			avr_cycle_timer_register(avr, cycles, charged, pad);
+		} else {
+			// output again: end of the measuring window
+			avr_cycle_timer_cancel(avr, charged, pad);
+			avr_cycle_count_t window = avr->cycle - pad->start;
+			if (pad->windows == 0 || window < pad->minimum) pad->minimum = window;
+			if (window > pad->maximum) pad->maximum = window;
+			pad->sum += (double)window;
+			pad->windows++;
+		}
+	}
+}
+
+// function outputLine
+// prints one line of the serial output with the simulated time and compares it with the checks
+static void outputLine(const char *line)
+{
+	double now = timeMs();
+	printf("%10.3f ms  %s\n", now, line);
+	for (int i = 0; i < outputCheckCount; i++) {
+		OutputCheck *check = &outputChecks[i];
+		if (check->found >= 0 || now < check->from || now > check->to) continue;
+		if (strncmp(line, check->text, strlen(check->text)) == 0) check->found = now;
+	}
+}
+
+// serial output, collected line by line
+static char outputText[256];
+static size_t outputLength;
+
+// function uartOutput
+// collects the serial output and passes complete lines to outputLine()
+static void uartOutput(avr_irq_t *irq, uint32_t value, void *param)
+{
+	(void)irq;
+	(void)param;
+	if (value == '\n' || outputLength == sizeof(outputText) - 1) {
+		outputText[outputLength] = 0;
+		outputLine(outputText);
+		outputLength = 0;
+	} else if (value != '\r') {
+		outputText[outputLength++] = (char)value;
+	}
+}
+
+// function parsePad
+// pad:<port><bit>:<pF>
+static int parsePad(const char *text)
+{
+	char port;
+	int bit;
+	double capacitance;
+	if (padCount >= maxPads || sscanf(text, "pad:%c%d:%lf", &port, &bit, &capacitance) != 3 || bit < 0 || bit > 7) return 0;
+	Pad *pad = &pads[padCount++];
+	memset(pad, 0, sizeof(*pad));
+	pad->port = port;
+	pad->bit = (uint8_t)bit;
+	pad->capacitance = capacitance;
+	return 1;
+}
+
+// function parseTouch
+// touch:<port><bit>:<from ms>:<to ms>:<pF>
+static int parseTouch(const char *text)
+{
+	char name[3] = { 0, 0, 0 };
+	Touch *touch = &touches[touchCount];
+	if (touchCount >= maxTouches || sscanf(text, "touch:%c%c:%lf:%lf:%lf", &name[0], &name[1], &touch->from, &touch->to, &touch->capacitance) != 5) return 0;
+	touch->pad = findPad(name);
+	if (touch->pad < 0) return 0;
+	touchCount++;
+	return 1;
+}
+
+// function parseOutputCheck
+// <text>[@<from ms>:<to ms>], \t in the text is a tab
+static int parseOutputCheck(const char *text, int expected)
+{
+	if (outputCheckCount >= maxChecks) return 0;
+	OutputCheck *check = &outputChecks[outputCheckCount];
+	check->from = 0;
+	check->to = 1e12;
+	check->expected = expected;
+	check->found = -1;
+	const char *at = strrchr(text, '@');
+	if (at && sscanf(at, "@%lf:%lf", &check->from, &check->to) != 2) return 0;
+	size_t end = at ? (size_t)(at - text) : strlen(text);
+	size_t length = 0;
+	for (size_t i = 0; i < end; i++) {
+		if (length >= sizeof(check->text) - 1) return 0;
+		if (text[i] == '\\' && i + 1 < end && text[i + 1] == 't') {
+			check->text[length++] = '\t';
+			i++;
+		} else {
+			check->text[length++] = text[i];
+		}
+	}
+	check->text[length] = 0;
+	if (length == 0) return 0;
+	outputCheckCount++;
+	return 1;
+}
+
+// function parseWindowCheck
+// <port><bit>:<min>:<max>
+static int parseWindowCheck(const char *text)
+{
+	if (windowCheckCount >= maxChecks) return 0;
+	WindowCheck *check = &windowChecks[windowCheckCount];
+	memset(check, 0, sizeof(*check));
+	if (sscanf(text, "%c%c:%lf:%lf", &check->name[0], &check->name[1], &check->minimum, &check->maximum) != 4) return 0;
+	windowCheckCount++;
+	return 1;
+}
+
+// function checkResults
+// prints the result of all checks, returns the number of failed checks
+static int checkResults(void)
+{
+	int failures = 0;
+	for (int i = 0; i < outputCheckCount; i++) {
+		OutputCheck *check = &outputChecks[i];
+		int ok = check->expected ? check->found >= 0 : check->found < 0;
+		printf("%s  output %s \"", ok ? "ok  " : "FAIL", check->expected ? "has" : "has no");
+		for (const char *c = check->text; *c; c++) {
+			if (*c == '\t') printf("\\t");
+			else putchar(*c);
+		}
+		printf("\"");
+		if (check->to < 1e12) printf(" from %.0f to %.0f ms", check->from, check->to);
+		if (check->found >= 0) printf(" (%.3f ms)", check->found);
+		printf("\n");
+		if (!ok) failures++;
+	}
+	for (int i = 0; i < windowCheckCount; i++) {
+		WindowCheck *check = &windowChecks[i];
+		int index = findPad(check->name);
+		Pad *pad = index < 0 ? NULL : &pads[index];
+		double mean = pad && pad->windows ? pad->sum / pad->windows : 0.0;
+		int ok = pad && pad->windows && mean >= check->minimum && mean <= check->maximum;
+		printf("%s  window %s %.0f..%.0f cycles", ok ? "ok  " : "FAIL", check->name, check->minimum, check->maximum);
+		if (!pad) printf(" (no such pad)\n");
+		else if (!pad->windows) printf(" (no measurement)\n");
+		else printf(" (mean %.1f)\n", mean);
+		if (!ok) failures++;
+	}
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *mcu = "atmega2560";
+	unsigned long frequency = 16000000;
+	double duration = 3000;
+	int option;
+	while ((option = getopt(argc, argv, "m:f:t:r:v:e:x:w:")) != -1) {
+		if (option == 'm') mcu = optarg;
+		else if (option == 'f') frequency = strtoul(optarg, NULL, 10);
+		else if (option == 't') duration = atof(optarg);
+		else if (option == 'r') resistance = atof(optarg);
+		else if (option == 'v') threshold = atof(optarg) / 100.0;
+		else if (option == 'e' || option == 'x') {
+			if (!parseOutputCheck(optarg, option == 'e')) {
+				fprintf(stderr, "invalid output check: %s\n", optarg);
+				return 1;
+			}
+		} else if (option == 'w') {
+			if (!parseWindowCheck(optarg)) {
+				fprintf(stderr, "invalid window check: %s\n", optarg);
+				return 1;
+			}
+		}
+		else return 1;
+	}
+	if (optind + 2 > argc || threshold <= 0 || threshold >= 1) {
+		fprintf(stderr, "usage: %s [-m mcu] [-f Hz] [-t ms] [-r Ohm] [-v %%] [-e|-x text[@from:to]] [-w pad:min:max] <firmware.elf> <pad> ... [<touch> ...]\n", argv[0]);
+		return 1;
+	}
+
+	// pads first, the touches refer to them
+	for (int i = optind + 1; i < argc; i++) {
+		if (strncmp(argv[i], "pad:", 4) == 0 && !parsePad(argv[i])) {
+			fprintf(stderr, "invalid pad: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	for (int i = optind + 1; i < argc; i++) {
+		if (strncmp(argv[i], "pad:", 4) == 0) continue;
+		if (!parseTouch(argv[i])) {
+			fprintf(stderr, "invalid touch: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	// firmware and MCU
+	elf_firmware_t firmware;
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(argv[optind], &firmware) != 0) {
+		fprintf(stderr, "%s: cannot read firmware\n", argv[optind]);
+		return 1;
+	}
+	if (firmware.mmcu[0] == 0) strncpy(firmware.mmcu, mcu, sizeof(firmware.mmcu) - 1);
+	if (firmware.frequency == 0) firmware.frequency = frequency;
+	avr = avr_make_mcu_by_name(firmware.mmcu);
+	if (!avr) {
+		fprintf(stderr, "unknown MCU %s\n", firmware.mmcu);
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+
+	// RC model of the pads
+	for (int i = 0; i < padCount; i++) {
+		Pad *pad = &pads[i];
+		pad->irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(pad->port), pad->bit);
+		if (!pad->irq) {
+			fprintf(stderr, "no port %c on %s\n", pad->port, firmware.mmcu);
+			return 1;
+		}
+		// one notification per port
+		int first = 1;
+		for (int j = 0; j < i; j++) {
+			if (pads[j].port == pad->port) first = 0;
+		}
+		if (first) avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(pad->port), IOPORT_IRQ_DIRECTION_ALL), directionChanged, (void *)(intptr_t)pad->port);
+	}
+
+	// serial output
+	uint32_t flags = 0;
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartOutput, NULL);
+
+	// run
+	avr_cycle_count_t end = (avr_cycle_count_t)(duration / 1000.0 * avr->frequency);
+	int state = cpu_Running;
+	while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed) state = avr_run(avr);
+	// last line without newline
+	if (outputLength) {
+		outputText[outputLength] = 0;
+		outputLine(outputText);
+	}
+
+	// cycles of the measuring windows
+	printf("\npad  windows  min  mean  max (cycles from input to output)\n");
+	for (int i = 0; i < padCount; i++) {
+		Pad *pad = &pads[i];
+		printf("%c%d   %7lu  %4llu  %6.1f  %4llu\n", pad->port, pad->bit, pad->windows, (unsigned long long)pad->minimum,
+			pad->windows ? pad->sum / pad->windows : 0.0, (unsigned long long)pad->maximum);
+	}
+	if (state == cpu_Crashed) {
+		printf("\nfirmware crashed at %.3f ms\n", timeMs());
+		return 1;
+	}
+
+	// check mode
+	if (outputCheckCount == 0 && windowCheckCount == 0) return 0;
+	printf("\n");
+	int failures = checkResults();
+	if (failures) printf("%d checks failed\n", failures);
+	else printf("all checks passed\n");
+	return failures ? 1 : 0;
+}